@@ -12,6 +12,10 @@ from .qi_python \
   import (FutureState, FutureTimeout, Future, futureBarrier,  # noqa: E402
           Promise, Property, Session, Signal, runAsync, PeriodicTask,
           clockNow, steadyClockNow, systemClockNow, module, listModules,
+          setNumpyArrayConversion, numpyArrayConversion,
+          setLazyContainerViews, lazyContainerViews, ListView, MapView,
+          setColumnarConversion, columnarConversion,
+          registerStruct, encode, decode, encodeJSON, decodeJSON,
           Application as _Application,
           ApplicationSession as _ApplicationSession)
 from . import path  # noqa: E402
@@ -30,6 +34,10 @@ __all__ = [
     'FutureState', 'FutureTimeout', 'Future', 'futureBarrier', 'Promise',
     'Property', 'Session', 'Signal', 'runAsync', 'PeriodicTask', 'clockNow',
     'steadyClockNow', 'systemClockNow', 'module', 'listModules',
+    'setNumpyArrayConversion', 'numpyArrayConversion',
+    'setLazyContainerViews', 'lazyContainerViews', 'ListView', 'MapView',
+    'setColumnarConversion', 'columnarConversion',
+    'registerStruct', 'encode', 'decode', 'encodeJSON', 'decodeJSON',
     'path', 'Void', 'Bool', 'Int8', 'UInt8', 'Int16', 'UInt16', 'Int32',
     'UInt32', 'Int64', 'UInt64', 'Float', 'Double', 'String', 'List', 'Optional',
     'Map', 'Struct', 'Object', 'Dynamic', 'Buffer', 'AnyArguments', 'typeof',
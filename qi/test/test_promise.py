@@ -3,6 +3,7 @@
 #
 # -*- coding: utf-8 -*-
 
+import json
 import time
 import threading
 import pytest
@@ -111,6 +112,14 @@ def test_future_no_timeout():
     assert f.hasError() is False
 
 
+def test_future_value_json():
+    p = Promise()
+    f = p.future()
+    p.setValue({"cookies": [1, 2]})
+    assert json.loads(f.valueJSON()) == {"cookies": [1, 2]}
+    assert json.loads(f.valueJSON(pretty=True)) == {"cookies": [1, 2]}
+
+
 def test_future_timeout_immediate():
     p = Promise()
     f = p.future()
@@ -3,6 +3,8 @@
 #
 # -*- coding: utf-8 -*-
 
+import array
+import json
 import time
 import qi
 import pytest
@@ -114,14 +116,152 @@ def test_builtin_types():
     # bytearray
     assert service.display(bytearray("lol", encoding="ascii")) == "lol"
 
-    # buffer (not implemented)
-    with pytest.raises(RuntimeError):
-        service.display(memoryview("lol".encode()))
+    # buffer
+    assert service.display(memoryview("lol".encode())).tobytes() == b"lol"
+    assert service.display(array.array("B", b"lol")).tobytes() == b"lol"
 
     time.sleep(0.01)
     s.close()
 
 
+def test_numeric_buffers():
+    local = "tcp://127.0.0.1:0"
+    sd = qi.Session()
+    sd.listenStandalone(local)
+
+    s = qi.Session()
+    s.connect(sd.endpoints()[0])
+
+    m = TestService()
+    s.registerService("TestService", m)
+    service = s.service("TestService")
+
+    assert service.display(array.array("d", [1.5, 2.5])) == [1.5, 2.5]
+    assert service.display(array.array("i", [1, -2])) == [1, -2]
+
+    s.close()
+
+
+def test_numpy_arrays():
+    np = pytest.importorskip("numpy")
+
+    local = "tcp://127.0.0.1:0"
+    sd = qi.Session()
+    sd.listenStandalone(local)
+
+    s = qi.Session()
+    s.connect(sd.endpoints()[0])
+
+    class NumericService:
+        @qi.bind(qi.List(qi.Double))
+        def doubles(self):
+            return [1.5, 2.5]
+
+        def display(self, t):
+            return t
+
+    s.registerService("NumericService", NumericService())
+    service = s.service("NumericService")
+
+    assert not qi.numpyArrayConversion()
+    assert service.display(np.arange(3.0)) == [0.0, 1.0, 2.0]
+
+    res = service.doubles(_numpy=True)
+    assert isinstance(res, np.ndarray)
+    assert res.tolist() == [1.5, 2.5]
+    assert isinstance(service.doubles(), list)
+
+    qi.setNumpyArrayConversion(True)
+    try:
+        assert qi.numpyArrayConversion()
+        assert isinstance(service.doubles(), np.ndarray)
+        assert isinstance(service.doubles(_numpy=False), list)
+    finally:
+        qi.setNumpyArrayConversion(False)
+
+    with pytest.raises(ValueError):
+        service.doubles(_numpy=True, _async=True)
+
+    s.close()
+
+
+def test_lazy_container_views():
+    local = "tcp://127.0.0.1:0"
+    sd = qi.Session()
+    sd.listenStandalone(local)
+
+    s = qi.Session()
+    s.connect(sd.endpoints()[0])
+
+    m = TestService()
+    s.registerService("TestService", m)
+    service = s.service("TestService")
+
+    value = {"cookies": [1, 2], "muffins": [3]}
+    assert not qi.lazyContainerViews()
+    assert isinstance(service.display(value), dict)
+
+    view = service.display(value, _lazy=True)
+    assert isinstance(view, qi.MapView)
+    assert len(view) == 2
+    assert "cookies" in view
+    assert isinstance(view["cookies"], qi.ListView)
+    assert view["cookies"][-1] == 2
+    assert list(view["cookies"]) == [1, 2]
+    assert view.get("donuts") is None
+    assert view == value
+    assert view.materialize() == value
+
+    # A view passed back to a call is not converted again.
+    assert service.display(view) == value
+
+    with pytest.raises(ValueError):
+        service.display(value, _lazy=True, _async=True)
+
+    s.close()
+
+
+def test_struct_classes():
+    import dataclasses
+    import typing
+
+    @qi.registerStruct
+    @dataclasses.dataclass
+    class Cookie:
+        weight: float
+        label: str
+
+    class Muffin(typing.NamedTuple):
+        flavor: str
+        size: int
+
+    qi.registerStruct(Muffin, "Cupcake")
+
+    local = "tcp://127.0.0.1:0"
+    sd = qi.Session()
+    sd.listenStandalone(local)
+
+    s = qi.Session()
+    s.connect(sd.endpoints()[0])
+
+    m = TestService()
+    s.registerService("TestService", m)
+    service = s.service("TestService")
+
+    cookie = service.display(Cookie(2.5, "chocolate"))
+    assert isinstance(cookie, Cookie)
+    assert cookie == Cookie(2.5, "chocolate")
+
+    muffin = service.display(Muffin("blueberry", 2))
+    assert isinstance(muffin, Muffin)
+    assert muffin == ("blueberry", 2)
+
+    with pytest.raises(TypeError):
+        qi.registerStruct(TestService)
+
+    s.close()
+
+
 def test_object_types():
     local = "tcp://127.0.0.1:0"
     sd = qi.Session()
@@ -197,3 +337,60 @@ def test_type():
     assert not (qi.Int8 != qi.Int8)
     assert not (qi.Int8 != qi.Int8())
     assert not (qi.Int8() != qi.Int8)
+
+
+def test_binary_codec():
+    value = {"cookies": [1, 2], "muffins": [3]}
+    data = qi.encode(value, "{s[i]}")
+    assert isinstance(data, bytes)
+    assert qi.decode(data, "{s[i]}") == value
+    assert qi.decode(bytearray(data), qi.Map(qi.String, qi.List(qi.Int32))) == value
+
+    # Dynamic values carry their signature in the data.
+    assert qi.decode(qi.encode(value, "m"), "m") == value
+
+    with pytest.raises(ValueError):
+        qi.encode(value, "{s[i]")
+
+    with pytest.raises(RuntimeError):
+        qi.decode(data + b"\0", "{s[i]}")
+
+
+def test_json_codec():
+    value = {"cookies": [1, 2], "label": "chocolate"}
+    assert json.loads(qi.encodeJSON(value)) == value
+    assert qi.decodeJSON(qi.encodeJSON(value, pretty=True)) == value
+
+    with pytest.raises(RuntimeError):
+        qi.decodeJSON('{"cookies": [1, 2}')
+
+
+def test_columnar_conversion():
+    local = "tcp://127.0.0.1:0"
+    sd = qi.Session()
+    sd.listenStandalone(local)
+
+    s = qi.Session()
+    s.connect(sd.endpoints()[0])
+
+    class SensorService:
+        @qi.bind("[(ds)]")
+        def history(self):
+            return [(0.5, "cookie"), (1.5, "muffin")]
+
+    s.registerService("SensorService", SensorService())
+    service = s.service("SensorService")
+
+    assert not qi.columnarConversion()
+    assert service.history() == [(0.5, "cookie"), (1.5, "muffin")]
+
+    res = service.history(_columnar=True)
+    assert isinstance(res[0], array.array)
+    assert res[0].typecode == "d"
+    assert res[0].tolist() == [0.5, 1.5]
+    assert res[1] == ["cookie", "muffin"]
+
+    with pytest.raises(ValueError):
+        service.history(_columnar=True, _async=True)
+
+    s.close()
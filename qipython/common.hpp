@@ -209,10 +209,10 @@ namespace detail
 
     // C++ -> Python
     static handle cast(qi::AnyValue src,
-                       return_value_policy policy,
-                       handle parent)
+                       return_value_policy /* policy */,
+                       handle /* parent */)
     {
-      return RefCaster::cast(src.asReference(), policy, parent);
+      return qi::py::unwrapValue(std::move(src)).release();
     }
   };
 
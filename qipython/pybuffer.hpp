@@ -0,0 +1,37 @@
+/*
+**  Copyright (C) 2023 Aldebaran Robotics
+**  See COPYING for the license
+*/
+
+#pragma once
+
+#ifndef QIPYTHON_PYBUFFER_HPP
+#define QIPYTHON_PYBUFFER_HPP
+
+#include <qipython/common.hpp>
+#include <qi/anyvalue.hpp>
+
+namespace qi
+{
+namespace py
+{
+
+/// Returns a read-only Python `memoryview` over the data of a raw value.
+///
+/// The data is not copied: the view is exported by an object that holds a
+/// copy of the raw value, and `qi::Buffer` copies share their underlying data.
+/// The exporting object is accessible through the `obj` attribute of the view.
+/// If the value is a `qi::Buffer`, its sub-buffers are exposed, as views
+/// themselves, by the `subBuffers` member function of that object.
+///
+/// @pre `raw.kind() == TypeKind_Raw`
+/// @pre The GIL is locked.
+/// @post the returned value is not a null object (it evaluates to true).
+pybind11::memoryview rawToMemoryView(AnyReference raw);
+
+void exportBuffer(pybind11::module& module);
+
+} // namespace py
+} // namespace qi
+
+#endif // QIPYTHON_PYBUFFER_HPP
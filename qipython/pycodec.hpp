@@ -0,0 +1,69 @@
+/*
+**  Copyright (C) 2023 Aldebaran Robotics
+**  See COPYING for the license
+*/
+
+#pragma once
+
+#ifndef QIPYTHON_PYCODEC_HPP
+#define QIPYTHON_PYCODEC_HPP
+
+#include <qipython/common.hpp>
+#include <pybind11/pybind11.h>
+
+namespace qi
+{
+namespace py
+{
+
+/// Encodes a Python object as a value of a signature with the binary codec of
+/// libqi.
+///
+/// The object is converted to a value of the type of the signature, and the
+/// value is then encoded with the GIL released. The data of raw values is
+/// inlined after their size, so that the result is self-contained.
+///
+/// Objects cannot be encoded, as they only make sense in a session.
+///
+/// @throws `std::invalid_argument` if the signature is not valid.
+/// @pre The GIL is locked.
+pybind11::bytes encode(pybind11::object value, const std::string& signature);
+
+/// Decodes data encoded with the binary codec of libqi as a value of a
+/// signature, and converts it to a Python object.
+///
+/// The data is any object supporting the buffer protocol with contiguous data.
+/// It is decoded with the GIL released and must be entirely consumed by the
+/// value.
+///
+/// @throws `std::invalid_argument` if the signature is not valid.
+/// @throws `std::runtime_error` if the data is not a value of the signature.
+/// @pre The GIL is locked.
+pybind11::object decode(const pybind11::object& data, const std::string& signature);
+
+/// Encodes a Python object as JSON with the JSON codec of libqi.
+///
+/// The JSON is encoded with the GIL released. The GIL is only locked while the
+/// Python objects of the value are read, as any conversion of an object does
+/// when it is not already locked. The values of futures can be encoded
+/// entirely without the GIL with the `valueJSON` member function of
+/// `qi.Future`.
+///
+/// @pre The GIL is locked.
+std::string encodeJSON(pybind11::object value, bool pretty);
+
+/// Decodes JSON with the JSON codec of libqi, and converts the value to a
+/// Python object.
+///
+/// The JSON is decoded with the GIL released.
+///
+/// @throws `std::runtime_error` if the data is not valid JSON.
+/// @pre The GIL is locked.
+pybind11::object decodeJSON(const std::string& data);
+
+void exportCodec(pybind11::module& module);
+
+} // namespace py
+} // namespace qi
+
+#endif // QIPYTHON_PYCODEC_HPP
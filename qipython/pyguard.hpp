@@ -11,7 +11,11 @@
 #include <qipython/common.hpp>
 #include <ka/typetraits.hpp>
 #include <pybind11/pybind11.h>
+#include <atomic>
+#include <cstddef>
+#include <mutex>
 #include <type_traits>
+#include <utility>
 
 namespace qi
 {
@@ -62,6 +66,99 @@ void pybind11GuardDisarm(G& guard)
 #endif
 }
 
+/// Returns whether the current thread has an attached thread state, which,
+/// with the GIL, means that it holds the GIL. Unlike `PyGILState_Check`, it
+/// only reads a thread-local variable.
+inline bool currentThreadHasThreadState()
+{
+#if PY_VERSION_HEX >= 0x030D0000
+  return ::PyThreadState_GetUnchecked() != nullptr;
+#else
+  return ::_PyThreadState_UncheckedGet() != nullptr;
+#endif
+}
+
+/// Number of the `GILAcquire` objects alive in the current thread that
+/// guarantee that it holds the GIL. A `GILRelease` object resets it for its
+/// lifetime, as the GIL is then released.
+///
+/// The GIL may still be released by other means while such objects are alive
+/// (for instance by another extension that is called from Python code), which
+/// is why the counter is only trusted if the thread has a thread state.
+inline thread_local std::size_t gilAcquireDepth = 0;
+
+/// Whether the thread states of the threads that Python does not know of are
+/// kept, and the generation of these thread states, which changes when the
+/// interpreter exits, as it then destroys them. The generation only changes
+/// with the mutex locked.
+struct PersistentThreadStates
+{
+  std::atomic<bool> enabled{ false };
+  std::atomic<std::size_t> generation{ 0 };
+  std::mutex mutex;
+};
+
+inline PersistentThreadStates& persistentThreadStates()
+{
+  static PersistentThreadStates states;
+  return states;
+}
+
+/// Keeps the thread state that Python creates for a thread it does not know of
+/// (such as a worker thread of libqi) when it first acquires the GIL, until the
+/// thread exits. Otherwise, Python creates and destroys a thread state each
+/// time such a thread acquires then releases the GIL.
+///
+/// The thread state is kept by holding an additional use of it, which is
+/// released at the exit of the thread, unless the interpreter has exited since
+/// then.
+class PersistentThreadState
+{
+public:
+  PersistentThreadState() = default;
+
+  /// @pre The current thread holds the GIL.
+  inline void keep()
+  {
+    const auto& states = persistentThreadStates();
+    const auto generation = states.generation.load();
+    if (_generation == generation || !states.enabled.load())
+      return;
+    ::PyGILState_Ensure();
+    _generation = generation;
+  }
+
+  inline ~PersistentThreadState()
+  {
+    if (!_generation)
+      return;
+
+    // The interpreter runs its exit hooks before it starts finalizing, and
+    // the hook that changes the generation waits for the lock. Holding it
+    // from the check of the generation until the GIL is released guarantees
+    // that the thread state is not destroyed in the meantime.
+    auto& states = persistentThreadStates();
+    std::lock_guard<std::mutex> lock(states.mutex);
+    if (*_generation != states.generation.load())
+      return;
+    if (Py_IsInitialized() != 1 || interpreterIsFinalizing().value_or(true))
+      return;
+
+    // The release of the last use of the thread state destroys it.
+    const auto state = ::PyGILState_Ensure();
+    ::PyGILState_Release(PyGILState_LOCKED);
+    ::PyGILState_Release(state);
+  }
+
+  PersistentThreadState(const PersistentThreadState&) = delete;
+  PersistentThreadState& operator=(const PersistentThreadState&) = delete;
+
+private:
+  boost::optional<std::size_t> _generation;
+};
+
+inline thread_local PersistentThreadState persistentThreadState;
+
 } // namespace detail
 
 /// RAII utility type that guarantees that the GIL is locked for the scope of
@@ -72,26 +169,46 @@ void pybind11GuardDisarm(G& guard)
 /// Objects of this type (or objects composed of them) must not be kept alive
 /// after the hand is given back to the interpreter.
 ///
-/// This type is re-entrant.
+/// This type is re-entrant. Nested objects only increment a thread-local
+/// counter and check that the thread still has a thread state, the state of
+/// the interpreter and of the GIL is only fully checked by the outermost one.
+/// The thread state that Python creates for a thread it does not know of is
+/// kept until the thread exits, if persistent thread states are enabled (see
+/// `enablePersistentThreadStates`).
 ///
 /// postcondition: `GILAcquire acq;` establishes `gilExistsAndCurrentThreadHoldsIt()`
 struct GILAcquire
 {
   inline GILAcquire()
   {
-    if (gilExistsAndCurrentThreadHoldsIt())
+    if (detail::gilAcquireDepth > 0 && detail::currentThreadHasThreadState())
+    {
+      ++detail::gilAcquireDepth;
       return;
+    }
 
-    const auto isFinalizing = interpreterIsFinalizing().value_or(false);
-    if (isFinalizing)
-      throw InterpreterFinalizingException();
-
-    _state = ::PyGILState_Ensure();
-    QI_ASSERT(gilExistsAndCurrentThreadHoldsIt());
+    if (!gilExistsAndCurrentThreadHoldsIt())
+    {
+      const auto isFinalizing = interpreterIsFinalizing().value_or(false);
+      if (isFinalizing)
+        throw InterpreterFinalizingException();
+
+      const auto hasThreadState = ::PyGILState_GetThisThreadState() != nullptr;
+      _state = ::PyGILState_Ensure();
+      QI_ASSERT(gilExistsAndCurrentThreadHoldsIt());
+      if (!hasThreadState)
+        detail::persistentThreadState.keep();
+    }
+    ++detail::gilAcquireDepth;
   }
 
   inline ~GILAcquire()
   {
+    // The counter may have been reset by a `GILRelease` that could not
+    // reacquire the GIL.
+    if (detail::gilAcquireDepth > 0)
+      --detail::gilAcquireDepth;
+
     // Even if releasing the GIL while the interpreter is finalizing is allowed, it does
     // require the GIL to be currently held. But we have no guarantee that this is the case,
     // because the GIL may have been released since we acquired it, and we could not
@@ -123,6 +240,7 @@ private:
 struct GILRelease
 {
   inline GILRelease()
+    : _acquireDepth(std::exchange(detail::gilAcquireDepth, 0))
   {
     // Even if releasing the GIL while the interpreter is finalizing is allowed,
     // it does require the GIL to be currently held. However, reacquiring the
@@ -155,16 +273,41 @@ struct GILRelease
     // it may terminate the current thread.
     const auto isFinalizing = interpreterIsFinalizing().value_or(false);
     if (_release && isFinalizing)
+    {
+      // The GIL stays released, the enclosing `GILAcquire` objects no longer
+      // guarantee that it is held.
       detail::pybind11GuardDisarm(*_release);
+      return;
+    }
+    detail::gilAcquireDepth = _acquireDepth;
   }
 
   GILRelease(const GILRelease&) = delete;
   GILRelease& operator=(const GILRelease&) = delete;
 
 private:
+  std::size_t _acquireDepth;
   boost::optional<pybind11::gil_scoped_release> _release;
 };
 
+/// Enables the persistent thread states of the threads that Python does not
+/// know of (see `detail::PersistentThreadState`), until the interpreter exits.
+///
+/// @pre The GIL is locked.
+inline void enablePersistentThreadStates()
+{
+  detail::persistentThreadStates().enabled.store(true);
+  pybind11::module::import("atexit").attr("register")(pybind11::cpp_function([] {
+    // The GIL is released while waiting for the lock, as the threads that
+    // exit acquire the GIL while they hold it.
+    GILRelease unlock;
+    auto& states = detail::persistentThreadStates();
+    std::lock_guard<std::mutex> lock(states.mutex);
+    states.enabled.store(false);
+    ++states.generation;
+  }));
+}
+
 /// Wraps a Python object as a shared reference-counted value that does not
 /// require the GIL to copy, move or assign to.
 ///
@@ -10,14 +10,99 @@
 
 #include <qipython/common.hpp>
 #include <qi/anyvalue.hpp>
+#include <qi/signature.hpp>
+#include <boost/optional.hpp>
+#include <array>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace qi
 {
 namespace py
 {
 
+/// Converts a value to a Python object.
+///
+/// If the conversion of numeric lists to numpy arrays is enabled (see
+/// `numpyArrayConversionEnabled`), lists of integers or floating point numbers
+/// are converted to one-dimensional `numpy.ndarray` objects of the
+/// corresponding data type instead of Python lists.
+///
+/// If the conversion of lists of structures to columns is enabled (see
+/// `columnarConversionEnabled`), lists whose elements are structures are
+/// converted to dicts of one column per member. The members are gathered with
+/// the GIL released, in a single traversal of the list.
+///
+/// If the conversion of lists and maps to lazy views is enabled (see
+/// `lazyContainerViewsEnabled`), other lists and maps are converted to views
+/// (see `tryContainerToView`).
 pybind11::object unwrapValue(AnyReference val);
 
+/// Converts a value to a Python object, taking ownership of it. The views of
+/// its lists and maps share it instead of copying it.
+pybind11::object unwrapValue(AnyValue&& val);
+
+/// Returns whether numeric lists are converted to numpy arrays in the current
+/// thread, which is the case if it is enabled globally or for the current
+/// scope of the thread.
+bool numpyArrayConversionEnabled();
+
+/// Enables or disables globally the conversion of numeric lists to numpy
+/// arrays. numpy is an optional dependency: it is only imported when the
+/// conversion is enabled.
+///
+/// @throws `pybind11::error_already_set` if the conversion is enabled and numpy
+///   cannot be imported.
+/// @pre The GIL is locked.
+void setNumpyArrayConversionEnabled(bool enabled);
+
+/// Enables or disables the conversion of numeric lists to numpy arrays in the
+/// current thread, for the lifetime of the scope, regardless of the global
+/// setting.
+class NumpyArrayConversionScope
+{
+public:
+  /// @throws `pybind11::error_already_set` if the conversion is enabled and
+  ///   numpy cannot be imported.
+  /// @pre The GIL is locked.
+  explicit NumpyArrayConversionScope(bool enabled);
+  ~NumpyArrayConversionScope();
+
+  NumpyArrayConversionScope(const NumpyArrayConversionScope&) = delete;
+  NumpyArrayConversionScope& operator=(const NumpyArrayConversionScope&) = delete;
+
+private:
+  boost::optional<bool> _previous;
+};
+
+/// Returns whether lists of structures are converted to columns in the
+/// current thread, which is the case if it is enabled globally or for the
+/// current scope of the thread.
+bool columnarConversionEnabled();
+
+/// Enables or disables globally the conversion of lists of structures to
+/// columns.
+void setColumnarConversionEnabled(bool enabled);
+
+/// Enables or disables the conversion of lists of structures to columns in
+/// the current thread, for the lifetime of the scope, regardless of the global
+/// setting.
+class ColumnarConversionScope
+{
+public:
+  explicit ColumnarConversionScope(bool enabled);
+  ~ColumnarConversionScope();
+
+  ColumnarConversionScope(const ColumnarConversionScope&) = delete;
+  ColumnarConversionScope& operator=(const ColumnarConversionScope&) = delete;
+
+private:
+  boost::optional<bool> _previous;
+};
+
 /// Introspects a Python object to create a `qi::AnyReference` around its value
 /// with the corresponding type.
 ///
@@ -37,11 +122,36 @@ pybind11::object unwrapValue(AnyReference val);
 ///   - exactly a set (or frozenset): TypeKind_Tuple.
 ///   - exactly a list: TypeKind_List.
 ///   - exactly a dict: TypeKind_Map.
+///   - an instance of a subclass of one of the types above (an IntEnum
+///     member, numpy.float64, numpy.str_, OrderedDict...): as an instance of
+///     that type. Only its builtin part is read, regardless of the members
+///     that the subclass overrides. Classes registered as structure types
+///     are converted as such (see below).
+///   - a numpy scalar of a boolean, integer or floating point number type
+///     (numpy.bool_, numpy.int32, numpy.float32...): TypeKind_Int or
+///     TypeKind_Float.
+///   - an object exporting a one-dimensional contiguous buffer of integers of
+///     at least 2 bytes or of floating point numbers in the native byte order
+///     (numpy.ndarray, array.array...): TypeKind_List, whose element type is
+///     the corresponding C++ arithmetic type. Elements are read directly from
+///     the data of the buffer, without being converted to Python objects.
+///   - an object exporting any other contiguous buffer (memoryview, bytes
+///     arrays...): TypeKind_Raw.
+///   - exactly an instance of a class registered as a structure type (see
+///     `registerStructClass`): TypeKind_Tuple.
+///   - a `qi.ListView` or a `qi.MapView`: the container it views, as is.
+///
+/// The data of buffers is borrowed from the object, whose buffer stays exported
+/// for as long as the reference lives, which prevents the object from being
+/// resized in the meantime.
+///
+/// The data of bytes and byte arrays is not copied either: bytes are borrowed
+/// as is, and the buffer of byte arrays is exported for as long as their data
+/// is in use.
 ///
 /// The function will throw an exception if the object is:
 ///   - an ellipsis.
 ///   - exactly a complex.
-///   - a memoryview.
 ///   - a slice.
 ///   - a module.
 ///
@@ -52,8 +162,259 @@ pybind11::object unwrapValue(AnyReference val);
 /// @pre `obj`
 AnyReference unwrapAsRef(pybind11::object& obj);
 
+/// Registers a Python class, which must be a dataclass or a NamedTuple class,
+/// as a structure type of a name. Instances of the class are converted to
+/// structures of that name, whose members are the fields of the class, instead
+/// of dynamic objects. Structures of that name and with the same fields are
+/// converted to instances of the class instead of dictionaries.
+///
+/// Fields annotated with `bool`, `int`, `float` or `str` have the type of
+/// that primitive, and the other fields are dynamic.
+///
+/// @throws `pybind11::type_error` if the class is neither a dataclass nor a
+///   NamedTuple class.
+void registerStructClass(const pybind11::object& cls, const std::string& name);
+
+/// Plan of the conversions between Python objects and the values of the
+/// parameters and of the result of a method.
+///
+/// The plan is compiled once from the signatures of the method, as a flat
+/// sequence of steps, one per parameter plus one for the result. Each step is
+/// specialized for the type of its signature: values and objects of the
+/// expected types are converted directly, without a dispatch on their type.
+/// Steps fall back to the generic conversions (`unwrapValue` and
+/// `unwrapAsRef`) for types without a specialized conversion and for values or
+/// objects of unexpected types.
+class ConversionPlan
+{
+public:
+  struct Step
+  {
+    /// @pre The GIL is locked.
+    pybind11::object (*toPyObject)(AnyReference value);
+    /// @pre The GIL is locked.
+    AnyValue (*fromPyObject)(const pybind11::object& obj);
+  };
+
+  ConversionPlan(const Signature& parametersSignature, const Signature& returnSignature);
+
+  /// Returns the plan of the signatures, compiled on the first request and
+  /// shared by all the methods with the same signatures.
+  static std::shared_ptr<const ConversionPlan> of(const Signature& parametersSignature,
+                                                  const Signature& returnSignature);
+
+  std::size_t parameterCount() const { return _parameters.size(); }
+
+  /// @pre `index < parameterCount()`
+  /// @pre The GIL is locked.
+  pybind11::object parameterToPyObject(std::size_t index, AnyReference value) const
+  {
+    return _parameters[index].toPyObject(value);
+  }
+
+  /// @pre `index < parameterCount()`
+  /// @pre The GIL is locked.
+  AnyValue parameterFromPyObject(std::size_t index, const pybind11::object& obj) const
+  {
+    return _parameters[index].fromPyObject(obj);
+  }
+
+  /// @pre The GIL is locked.
+  pybind11::object resultToPyObject(AnyReference value) const
+  {
+    return _result.toPyObject(value);
+  }
+
+  /// @pre The GIL is locked.
+  AnyValue resultFromPyObject(const pybind11::object& obj) const
+  {
+    return _result.fromPyObject(obj);
+  }
+
+private:
+  std::vector<Step> _parameters;
+  Step _result;
+};
+
 void registerTypes();
 
+void exportTypes(pybind11::module& module);
+
+namespace detail
+{
+
+/// References to the elements of a container, made while reading it.
+///
+/// A reference stored at a slot (usually the index of the element) is reused by
+/// later reads of the same slot for as long as it is reusable, typically as
+/// long as the element is the same object. A reference that is not reusable
+/// anymore is replaced in its slot, but it is not destroyed: readers may still
+/// be using it. All the references are destroyed with the set.
+///
+/// This type is thread-safe.
+class ElementReferences
+{
+public:
+  ElementReferences() = default;
+  ~ElementReferences();
+
+  ElementReferences(const ElementReferences&) = delete;
+  ElementReferences& operator=(const ElementReferences&) = delete;
+
+  /// Returns the reference stored at a slot if there is one and if `reusable`
+  /// returns true for it. Otherwise, stores the reference that `make` returns
+  /// at that slot and returns it.
+  ///
+  /// `make` is called without the lock of the references, as it may run
+  /// Python code.
+  ///
+  /// Predicate<AnyReference> Reusable
+  /// Procedure<AnyReference ()> Make
+  template<typename Reusable, typename Make>
+  AnyReference at(std::uintptr_t slot, Reusable&& reusable, Make&& make);
+
+  /// Returns the number of references that were replaced in their slot.
+  std::size_t replacedCount() const;
+
+private:
+  mutable std::mutex _mutex;
+  std::unordered_map<std::uintptr_t, AnyReference> _slots;
+  std::vector<AnyReference> _replaced;
+};
+
+template<typename Reusable, typename Make>
+AnyReference ElementReferences::at(std::uintptr_t slot, Reusable&& reusable, Make&& make)
+{
+  {
+    std::scoped_lock<std::mutex> lock(_mutex);
+    const auto it = _slots.find(slot);
+    if (it != _slots.end() && reusable(it->second))
+      return it->second;
+  }
+
+  auto made = std::forward<Make>(make)();
+  AnyReference stored;
+  {
+    std::scoped_lock<std::mutex> lock(_mutex);
+    auto& slotRef = _slots[slot];
+    if (!slotRef.isValid() || !reusable(slotRef))
+    {
+      if (slotRef.isValid())
+        _replaced.push_back(slotRef);
+      slotRef = made;
+      return made;
+    }
+    stored = slotRef;
+  }
+
+  // A reusable reference was stored in the meantime. The one that was made
+  // was not returned to anyone, it can be destroyed right away.
+  made.destroy();
+  return stored;
+}
+
+/// Storage of 'disowned' references, which are references that are not
+/// expected to be automatically destroyed, meaning we have to manually call
+/// destroy on them. The storage associates such references to a type-erased
+/// context (usually the storage of a value) so that they can later be retrieved
+/// and destroyed along with it.
+///
+/// The storage is split in shards that each have their own lock. The shard of
+/// a context is selected from its address, so that threads working on
+/// different values rarely contend.
+///
+/// This type is thread-safe.
+class DisownedReferencesStorage
+{
+public:
+  struct References
+  {
+    std::unordered_map<std::uintptr_t, AnyReference> slots;
+    std::shared_ptr<ElementReferences> elements;
+  };
+
+  /// Returns the reference stored at a slot of the context if there is one.
+  /// Otherwise, stores the reference that `make` returns at that slot and
+  /// returns it. The reference then lives as long as the context does.
+  ///
+  /// `make` is called without the lock of the storage, so that it may convert
+  /// other values.
+  ///
+  /// Procedure<AnyReference ()> Make
+  template<typename Make>
+  AnyReference storeOnceAt(void* context, std::uintptr_t slot, Make&& make);
+
+  /// Returns the reference stored at a slot of the context, or an invalid
+  /// reference if there is none.
+  AnyReference storedAt(void* context, std::uintptr_t slot);
+
+  /// Returns the references to the elements of the container that the context
+  /// is the storage of, which reads of the container share.
+  ///
+  /// The references live at least as long as the readers that hold them, such
+  /// as iterators, and as long as the context does. However, once more than
+  /// `2 * containerSize` of them were replaced, the context starts a new set
+  /// of references and releases the previous one. This way, the memory that a
+  /// long-lived container retains is proportional to its size, whatever the
+  /// number of times it is read and its elements are replaced.
+  std::shared_ptr<ElementReferences> elementReferences(void* context,
+                                                       std::size_t containerSize);
+
+  /// Removes the references associated to the context, including the ones
+  /// stored at its slots and its element references, and returns them.
+  References unstore(void* context);
+
+private:
+  static constexpr std::size_t shardCount = 64;
+
+  /// Minimal number of replaced element references after which a context
+  /// starts a new set, so that small containers do not start one on every
+  /// change.
+  static constexpr std::size_t minReplacedElementCount = 32;
+
+  // Aligned on a cache line to prevent false sharing between shards.
+  struct alignas(64) Shard
+  {
+    std::mutex mutex;
+    std::unordered_map<void*, References> references;
+  };
+
+  Shard& shardOf(void* context);
+
+  std::array<Shard, shardCount> _shards;
+};
+
+template<typename Make>
+AnyReference DisownedReferencesStorage::storeOnceAt(void* context,
+                                                    std::uintptr_t slot,
+                                                    Make&& make)
+{
+  const auto ref = storedAt(context, slot);
+  if (ref.isValid())
+    return ref;
+
+  auto made = std::forward<Make>(make)();
+  AnyReference stored;
+  {
+    auto& shard = shardOf(context);
+    std::scoped_lock<std::mutex> lock(shard.mutex);
+    auto& slotRef = shard.references[context].slots[slot];
+    if (!slotRef.isValid())
+    {
+      slotRef = made;
+      return made;
+    }
+    stored = slotRef;
+  }
+
+  // Another reference was stored in the meantime. The one that was made was
+  // not returned to anyone, it can be destroyed right away.
+  made.destroy();
+  return stored;
+}
+
+} // namespace detail
+
 }
 }
 
@@ -0,0 +1,87 @@
+/*
+**  Copyright (C) 2023 Aldebaran Robotics
+**  See COPYING for the license
+*/
+
+#pragma once
+
+#ifndef QIPYTHON_PYVIEW_HPP
+#define QIPYTHON_PYVIEW_HPP
+
+#include <qipython/common.hpp>
+#include <qi/anyvalue.hpp>
+#include <boost/optional.hpp>
+#include <memory>
+
+namespace qi
+{
+namespace py
+{
+
+/// Returns whether lists and maps are converted to lazy views in the current
+/// thread, which is the case if it is enabled globally or for the current
+/// scope of the thread.
+bool lazyContainerViewsEnabled();
+
+/// Enables or disables globally the conversion of lists and maps to lazy
+/// views.
+void setLazyContainerViewsEnabled(bool enabled);
+
+/// Enables or disables the conversion of lists and maps to lazy views in the
+/// current thread, for the lifetime of the scope, regardless of the global
+/// setting.
+class LazyContainerViewsScope
+{
+public:
+  explicit LazyContainerViewsScope(bool enabled);
+  ~LazyContainerViewsScope();
+
+  LazyContainerViewsScope(const LazyContainerViewsScope&) = delete;
+  LazyContainerViewsScope& operator=(const LazyContainerViewsScope&) = delete;
+
+private:
+  boost::optional<bool> _previous;
+};
+
+/// Makes the views created in the current thread, for the lifetime of the
+/// scope, share a value that contains their containers, the root, instead of
+/// copying them.
+class ContainerViewsRootScope
+{
+public:
+  explicit ContainerViewsRootScope(std::shared_ptr<const AnyValue> root);
+  ~ContainerViewsRootScope();
+
+  ContainerViewsRootScope(const ContainerViewsRootScope&) = delete;
+  ContainerViewsRootScope& operator=(const ContainerViewsRootScope&) = delete;
+
+private:
+  std::shared_ptr<const AnyValue> _previous;
+};
+
+/// Returns a lazy view of a list (a `qi.ListView`) or of a map (a
+/// `qi.MapView`), if the value is one.
+///
+/// The view shares the root of the current thread if there is one (see
+/// `ContainerViewsRootScope`), and otherwise holds a copy of the value. It
+/// converts its elements to Python objects only when they are accessed. Nested
+/// lists and maps are themselves converted to views that share the same root.
+/// The `materialize` member function of a view returns its eager conversion.
+///
+/// @pre The GIL is locked.
+boost::optional<pybind11::object> tryContainerToView(AnyReference value);
+
+/// Returns a reference to the container that an object views, if the object
+/// is a `qi.ListView` or a `qi.MapView`, so that it is reused as is instead of
+/// being converted again. The reference is valid for as long as the view is
+/// alive.
+///
+/// @pre The GIL is locked.
+boost::optional<AnyReference> viewedContainer(const pybind11::object& obj);
+
+void exportView(pybind11::module& module);
+
+} // namespace py
+} // namespace qi
+
+#endif // QIPYTHON_PYVIEW_HPP
@@ -0,0 +1,113 @@
+/*
+**  Copyright (C) 2023 Aldebaran Robotics
+**  See COPYING for the license
+*/
+
+#include <qipython/pybuffer.hpp>
+#include <qipython/common.hpp>
+#include <qipython/pyguard.hpp>
+#include <qi/buffer.hpp>
+#include <qi/assert.hpp>
+#include <pybind11/pybind11.h>
+
+namespace py = pybind11;
+
+namespace qi
+{
+namespace py
+{
+
+namespace
+{
+
+/// Holds a raw value and exports its data through the Python buffer protocol.
+///
+/// Holding a copy of a `qi::Buffer` keeps its data alive without copying it, as
+/// copies of a buffer share their data.
+struct RawBuffer
+{
+  AnyValue value;
+
+  std::pair<char*, std::size_t> data() const
+  {
+    return value.asRaw();
+  }
+
+  /// Returns the buffer the value is, if it is one.
+  const Buffer* buffer() const
+  {
+    if (value.type()->info() != typeOf<Buffer>()->info())
+      return nullptr;
+    auto storage = value.rawValue();
+    return static_cast<const Buffer*>(value.type()->ptrFromStorage(&storage));
+  }
+};
+
+::py::buffer_info rawBufferInfo(const RawBuffer& rawBuffer)
+{
+  // An exporter must not give a null pointer, even when there is no data.
+  static char emptyData = 0;
+
+  auto data = rawBuffer.data();
+  if (!data.first)
+    data = { &emptyData, 0 };
+
+  return ::py::buffer_info(data.first, sizeof(char),
+                           ::py::format_descriptor<unsigned char>::format(), 1,
+                           { static_cast<::py::ssize_t>(data.second) },
+                           { static_cast<::py::ssize_t>(sizeof(char)) },
+                           /* readonly = */ true);
+}
+
+::py::memoryview toMemoryView(RawBuffer rawBuffer)
+{
+  const auto exporter = castToPyObject(std::move(rawBuffer));
+  auto view = ::py::reinterpret_steal<::py::memoryview>(
+    PyMemoryView_FromObject(exporter.ptr()));
+  if (!view)
+    throw ::py::error_already_set();
+  return view;
+}
+
+// Returns a list of pairs of the offset of each sub-buffer in the buffer and a
+// view on that sub-buffer. Sub-buffers of sub-buffers are accessible through
+// those views, so that the structure is never flattened.
+::py::list subBuffers(const RawBuffer& rawBuffer)
+{
+  ::py::list res;
+  const auto buffer = rawBuffer.buffer();
+  if (!buffer)
+    return res;
+
+  for (const auto& offsetAndSubBuffer : buffer->subBuffers())
+  {
+    auto subView = toMemoryView(RawBuffer{ AnyValue::from(offsetAndSubBuffer.second) });
+    res.append(::py::make_tuple(offsetAndSubBuffer.first, std::move(subView)));
+  }
+  return res;
+}
+
+} // namespace
+
+::py::memoryview rawToMemoryView(AnyReference raw)
+{
+  QI_ASSERT_TRUE(raw.kind() == TypeKind_Raw);
+  GILAcquire lock;
+  return toMemoryView(RawBuffer{ AnyValue(raw) });
+}
+
+void exportBuffer(::py::module& m)
+{
+  using namespace ::py;
+
+  GILAcquire lock;
+
+  class_<RawBuffer>(m, "_RawBuffer", buffer_protocol())
+    .def_buffer(&rawBufferInfo)
+    .def("subBuffers", &subBuffers,
+         doc(":returns: a list of pairs of the offset of each sub-buffer in the "
+             "buffer and a read-only memoryview on that sub-buffer."));
+}
+
+} // namespace py
+} // namespace qi
@@ -0,0 +1,229 @@
+/*
+**  Copyright (C) 2023 Aldebaran Robotics
+**  See COPYING for the license
+*/
+
+#include <qipython/pycodec.hpp>
+#include <qipython/common.hpp>
+#include <qipython/pyguard.hpp>
+#include <qipython/pytypes.hpp>
+#include <qi/binarycodec.hpp>
+#include <qi/buffer.hpp>
+#include <qi/jsoncodec.hpp>
+#include <qi/signature.hpp>
+#include <pybind11/pybind11.h>
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+
+namespace py = pybind11;
+
+namespace qi
+{
+namespace py
+{
+
+namespace
+{
+
+/// @throws `std::invalid_argument` if the signature is not valid.
+TypeInterface* signatureType(const std::string& signature)
+{
+  TypeInterface* type = nullptr;
+  try
+  {
+    const Signature sig(signature);
+    if (sig.isValid())
+      type = TypeInterface::fromSignature(sig);
+  }
+  catch (const std::exception&)
+  {
+    // Reported below as any other invalid signature.
+  }
+
+  if (!type)
+    throw std::invalid_argument("invalid signature '" + signature + "'");
+  return type;
+}
+
+/// Returns the size of the data of a buffer, once the data of its sub-buffers
+/// is inlined.
+std::size_t flatSize(const Buffer& buffer)
+{
+  auto size = buffer.size();
+  for (const auto& offsetAndSubBuffer : buffer.subBuffers())
+    size += flatSize(offsetAndSubBuffer.second);
+  return size;
+}
+
+/// Copies the data of a buffer, with the data of each of its sub-buffers
+/// inlined after the size of the sub-buffer, as they are sent over sockets.
+///
+/// @pre `out` can hold `flatSize(buffer)` bytes.
+char* flattenTo(const Buffer& buffer, char* out)
+{
+  const auto data = static_cast<const char*>(buffer.data());
+  std::size_t position = 0;
+  for (const auto& offsetAndSubBuffer : buffer.subBuffers())
+  {
+    const auto end = offsetAndSubBuffer.first + sizeof(std::uint32_t);
+    out = std::copy(data + position, data + end, out);
+    position = end;
+    out = flattenTo(offsetAndSubBuffer.second, out);
+  }
+  return std::copy(data + position, data + buffer.size(), out);
+}
+
+/// Exports the contiguous data of an object for the lifetime of the instance.
+class ContiguousData
+{
+public:
+  /// @pre The GIL is locked.
+  explicit ContiguousData(const ::py::object& obj)
+  {
+    if (PyObject_GetBuffer(obj.ptr(), &_view, PyBUF_SIMPLE) != 0)
+      throw ::py::error_already_set();
+  }
+
+  /// @pre The GIL is locked.
+  ~ContiguousData()
+  {
+    PyBuffer_Release(&_view);
+  }
+
+  ContiguousData(const ContiguousData&) = delete;
+  ContiguousData& operator=(const ContiguousData&) = delete;
+
+  const void* data() const { return _view.buf; }
+  std::size_t size() const { return static_cast<std::size_t>(_view.len); }
+
+private:
+  Py_buffer _view;
+};
+
+} // namespace
+
+::py::bytes encode(::py::object value, const std::string& signature)
+{
+  GILAcquire lock;
+
+  // The converted value may still refer to the object, such as through a
+  // dynamic value of an `m` signature. Encoding it without the GIL is safe as
+  // the interfaces of the Python types lock the GIL when they read the object.
+  AnyValue converted(signatureType(signature));
+  converted.update(unwrapAsRef(value));
+
+  Buffer buffer;
+  std::size_t size = 0;
+  {
+    GILRelease unlock;
+    encodeBinary(&buffer, converted.asReference());
+    size = flatSize(buffer);
+  }
+
+  auto res = ::py::reinterpret_steal<::py::bytes>(
+    PyBytes_FromStringAndSize(nullptr, static_cast<Py_ssize_t>(size)));
+  if (!res)
+    throw ::py::error_already_set();
+
+  // No other thread knows of the bytes object yet.
+  auto out = PyBytes_AS_STRING(res.ptr());
+  {
+    GILRelease unlock;
+    flattenTo(buffer, out);
+  }
+  return res;
+}
+
+::py::object decode(const ::py::object& data, const std::string& signature)
+{
+  GILAcquire lock;
+
+  AnyValue value(signatureType(signature));
+  {
+    const ContiguousData contiguousData(data);
+    GILRelease unlock;
+    Buffer buffer;
+    buffer.write(contiguousData.data(), contiguousData.size());
+    BufferReader reader(buffer);
+    decodeBinary(&reader, value.asReference());
+    if (reader.position() != buffer.size())
+      throw std::runtime_error("the data is longer than a value of signature '" +
+                               signature + "'");
+  }
+  return unwrapValue(std::move(value));
+}
+
+std::string encodeJSON(::py::object value, bool pretty)
+{
+  GILAcquire lock;
+  const auto ref = unwrapAsRef(value);
+
+  // The interfaces of the Python types lock the GIL when they read the object,
+  // the rest of the encoding runs without it.
+  GILRelease unlock;
+  return qi::encodeJSON(ref, pretty ? JsonOption_PrettyPrint : JsonOption_None);
+}
+
+::py::object decodeJSON(const std::string& data)
+{
+  GILAcquire lock;
+  AnyValue value;
+  {
+    GILRelease unlock;
+    value = qi::decodeJSON(data);
+  }
+  return unwrapValue(std::move(value));
+}
+
+void exportCodec(::py::module& m)
+{
+  using namespace ::py;
+  using namespace ::py::literals;
+
+  GILAcquire lock;
+
+  m.def("encode",
+        [](object value, const object& signature) {
+          return encode(std::move(value), ::py::str(signature));
+        },
+        "value"_a, "signature"_a,
+        doc("Encode a value with the binary codec of libqi, as messages are.\n"
+            "The encoding is done without the GIL.\n"
+            ":param value: the value to encode.\n"
+            ":param signature: the signature of the value, as a string or a type "
+            "(such as `qi.List(qi.Int32)`).\n"
+            ":returns: the encoded value, as bytes."));
+
+  m.def("decode",
+        [](const object& data, const object& signature) {
+          return decode(data, ::py::str(signature));
+        },
+        "data"_a, "signature"_a,
+        doc("Decode a value encoded with the binary codec of libqi.\n"
+            "The decoding is done without the GIL.\n"
+            ":param data: a bytes-like object of the encoded value.\n"
+            ":param signature: the signature of the value, as a string or a type "
+            "(such as `qi.List(qi.Int32)`).\n"
+            ":returns: the decoded value."));
+
+  m.def("encodeJSON", &encodeJSON,
+        "value"_a, "pretty"_a = false,
+        doc("Encode a value as JSON with the JSON codec of libqi.\n"
+            "The encoding is done without the GIL, which is only locked while "
+            "Python objects are read.\n"
+            ":param value: the value to encode.\n"
+            ":param pretty: whether the JSON is indented. Optional.\n"
+            ":returns: the JSON, as a string."));
+
+  m.def("decodeJSON", &decodeJSON,
+        "data"_a,
+        doc("Decode JSON with the JSON codec of libqi.\n"
+            "The decoding is done without the GIL.\n"
+            ":param data: the JSON, as a string.\n"
+            ":returns: the decoded value."));
+}
+
+} // namespace py
+} // namespace qi
@@ -19,7 +19,10 @@
 #include <qipython/pypath.hpp>
 #include <qipython/pytranslator.hpp>
 #include <qipython/pyclock.hpp>
+#include <qipython/pycodec.hpp>
 #include <qipython/pystrand.hpp>
+#include <qipython/pybuffer.hpp>
+#include <qipython/pyview.hpp>
 
 namespace py = pybind11;
 
@@ -34,6 +37,8 @@ void exportAll(pybind11::module& module)
 
   GILAcquire lock;
 
+  enablePersistentThreadStates();
+
   exportFuture(module);
   exportSignal(module);
   exportProperty(module);
@@ -47,6 +52,10 @@ void exportAll(pybind11::module& module)
   exportTranslator(module);
   exportStrand(module);
   exportClock(module);
+  exportBuffer(module);
+  exportView(module);
+  exportCodec(module);
+  exportTypes(module);
 }
 
 } // namespace py
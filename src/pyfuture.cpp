@@ -9,6 +9,7 @@
 #include <qipython/pystrand.hpp>
 #include <qi/future.hpp>
 #include <qi/anyobject.hpp>
+#include <qi/jsoncodec.hpp>
 #include <pybind11/pybind11.h>
 
 static constexpr const auto logCategory = "qi.python.future";
@@ -202,6 +203,21 @@ void exportFuture(::py::module& m)
                ":returns: the value of the future.\n"
                ":raises: a RuntimeError if the timeout is reached or the future has error."))
 
+      .def("valueJSON",
+           [](const Future& fut, int timeout, bool pretty) {
+             return qi::encodeJSON(fut.value(timeout).asReference(),
+                                   pretty ? JsonOption_PrettyPrint : JsonOption_None);
+           },
+           call_guard<GILRelease>(),
+           "timeout"_a = FutureTimeout_Infinite, "pretty"_a = false,
+           doc("Block until the future is ready.\n\n"
+               "The value is encoded as JSON directly, without the GIL and without "
+               "being converted to Python objects.\n"
+               ":param timeout: a time in milliseconds. Optional.\n"
+               ":param pretty: whether the JSON is indented. Optional.\n"
+               ":returns: the value of the future, as a JSON string.\n"
+               ":raises: a RuntimeError if the timeout is reached or the future has error."))
+
       .def("error", &Future::error,
            call_guard<GILRelease>(),
            "timeout"_a = FutureTimeout_Infinite,
@@ -11,8 +11,9 @@
 #include <qipython/pysignal.hpp>
 #include <qipython/pyproperty.hpp>
 #include <qipython/pystrand.hpp>
+#include <qipython/pytypes.hpp>
+#include <qipython/pyview.hpp>
 #include <qi/type/dynamicobjectbuilder.hpp>
-#include <qi/jsoncodec.hpp>
 #include <qi/strand.hpp>
 #include <qi/session.hpp>
 #include <pybind11/operators.h>
@@ -36,26 +37,85 @@ constexpr static const auto qiSignatureAttributeDoNotBindValue = "DONOTBIND";
 constexpr static const auto qiReturnSignatureAttributeName = "__qi_return_signature__";
 constexpr static const auto asyncArgName = "_async";
 constexpr static const auto overloadArgName = "_overload";
+constexpr static const auto numpyArgName = "_numpy";
+constexpr static const auto lazyArgName = "_lazy";
+constexpr static const auto columnarArgName = "_columnar";
 
 // Calls the function of a qi Object, with a list of Python arguments.
+//
+// If a conversion plan is given, it is the plan of the only method with that
+// name, and it converts the arguments and the result of synchronous calls.
 ::py::object call(const Object& obj, std::string funcName,
-                  ::py::args args, ::py::kwargs kwargs)
+                  ::py::args args, ::py::kwargs kwargs,
+                  std::shared_ptr<const ConversionPlan> plan = {})
 {
   GILAcquire lock;
 
   if (auto optOverload = extractKeywordArg<std::string>(kwargs, overloadArgName))
+  {
     funcName = *optOverload;
+    plan = {};
+  }
 
   auto async = false;
   if (auto optAsync = extractKeywordArg<bool>(kwargs, asyncArgName))
     async = *optAsync;
 
-  auto argsValue = AnyValue::from(args);
+  // The result of an asynchronous call is converted when the value of its
+  // future is read, out of the scope of the call.
+  boost::optional<NumpyArrayConversionScope> numpyScope;
+  if (auto optNumpy = extractKeywordArg<bool>(kwargs, numpyArgName))
+  {
+    if (async)
+      throw std::invalid_argument("the conversion to numpy arrays cannot be selected for an "
+                                  "asynchronous call");
+    numpyScope.emplace(*optNumpy);
+  }
+
+  boost::optional<LazyContainerViewsScope> lazyScope;
+  if (auto optLazy = extractKeywordArg<bool>(kwargs, lazyArgName))
+  {
+    if (async)
+      throw std::invalid_argument("the conversion to lazy views cannot be selected for an "
+                                  "asynchronous call");
+    lazyScope.emplace(*optLazy);
+  }
+
+  boost::optional<ColumnarConversionScope> columnarScope;
+  if (auto optColumnar = extractKeywordArg<bool>(kwargs, columnarArgName))
+  {
+    if (async)
+      throw std::invalid_argument("the conversion to columns cannot be selected for an "
+                                  "asynchronous call");
+    columnarScope.emplace(*optColumnar);
+  }
+
+  if (plan && plan->parameterCount() != args.size())
+    plan = {};
+
+  AnyValue argsValue;
+  std::vector<AnyValue> argValues;
+  AnyReferenceVector argRefs;
+  if (plan)
+  {
+    argValues.reserve(args.size());
+    argRefs.reserve(args.size());
+    for (std::size_t i = 0; i < args.size(); ++i)
+    {
+      argValues.push_back(plan->parameterFromPyObject(i, args[i]));
+      argRefs.push_back(argValues.back().asReference());
+    }
+  }
+  else
+  {
+    argsValue = AnyValue::from(args);
+    argRefs = argsValue.asTupleValuePtr();
+  }
 
   Promise prom;
   {
     GILRelease _unlock;
-    auto metaCallFut = obj.metaCall(funcName, argsValue.asTupleValuePtr(),
+    auto metaCallFut = obj.metaCall(funcName, argRefs,
                                     async ? MetaCallType_Queued : MetaCallType_Direct);
 
     // `adaptFutureUnwrap` supports `AnyReference` containing a `Future`, so
@@ -64,6 +124,12 @@ constexpr static const auto overloadArgName = "_overload";
     adaptFutureUnwrap(metaCallFut, prom);
   }
 
+  if (plan && !async)
+  {
+    // Wait for the future outside of the GIL.
+    const auto res = invokeGuarded<GILRelease>(qi::SrcFuture{}, prom.future());
+    return plan->resultToPyObject(res.asReference());
+  }
   return resultObject(prom.future(), async);
 }
 
@@ -92,9 +158,15 @@ void populateMethods(::py::object pyobj, const Object& obj)
 
     namespace sph = std::placeholders;
 
+    // Arguments can only be converted to the types of the parameters of the
+    // method if it has no overload, which would be selected by their types.
+    std::shared_ptr<const ConversionPlan> plan;
+    if (metaObj.findMethod(methodName).size() == 1)
+      plan = ConversionPlan::of(method.parametersSignature(), method.returnSignature());
+
     const auto doc = docString(method);
     std::function<::py::object(::py::args, ::py::kwargs)> callMethod =
-      std::bind(&call, obj, method.name(), sph::_1, sph::_2);
+      std::bind(&call, obj, method.name(), sph::_1, sph::_2, std::move(plan));
     ::py::setattr(pyobj, methodName.c_str(),
                   ::py::cpp_function(std::move(callMethod),
                                      ::py::is_method(pyobj.get_type()),
@@ -146,10 +218,16 @@ using GenericFunction = std::function<::py::object(::py::args)>;
 
 // Returns an owning AnyReference (it must be explicitly destroyed).
 //
+// The arguments and the result are converted according to the conversion plan
+// of the method. Raw values are converted to memoryviews, except the arguments
+// of the parameters annotated as bytes, which are converted to bytes.
+//
 // @pre `cargs.size() > 0`, arguments must at least contain a `DynamicObject`
 //      on which the function is to be called.
 AnyReference callPythonMethod(const AnyReferenceVector& cargs,
-                              const SharedObject<::py::function>& method)
+                              const SharedObject<::py::function>& method,
+                              const std::shared_ptr<const ConversionPlan>& plan,
+                              const std::vector<bool>& bytesParameters)
 {
   auto it = cargs.begin();
   const auto cargsEnd = cargs.end();
@@ -159,13 +237,24 @@ AnyReference callPythonMethod(const AnyReferenceVector& cargs,
   ++it;
 
   GILAcquire lock;
-  ::py::tuple args(std::distance(it, cargsEnd));
+  const auto argsCount = static_cast<std::size_t>(std::distance(it, cargsEnd));
+  const auto usePlan = plan->parameterCount() == argsCount;
+  ::py::tuple args(argsCount);
 
   ::py::size_t i = 0;
   while (it != cargsEnd)
   {
     QI_ASSERT_TRUE(i < args.size());
-    args[i++] = castToPyObject(*it++);
+    auto arg = usePlan ? plan->parameterToPyObject(i, *it) : castToPyObject(*it);
+    if (i < bytesParameters.size() && bytesParameters[i] && PyMemoryView_Check(arg.ptr()))
+    {
+      arg = ::py::reinterpret_steal<::py::object>(PyBytes_FromObject(arg.ptr()));
+      if (!arg)
+        throw ::py::error_already_set();
+    }
+    args[i] = std::move(arg);
+    ++i;
+    ++it;
   }
 
   // Convert Python future object into a C++ Future, to allow libqi to unwrap
@@ -173,7 +262,111 @@ AnyReference callPythonMethod(const AnyReferenceVector& cargs,
   const ::py::object ret = invokeCatchPythonError(method.inner(), *args);
   if (::py::isinstance<Future>(ret))
     return AnyValue::from(ret.cast<Future>()).release();
-  return AnyReference::from(ret).content().clone();
+  return plan->resultFromPyObject(ret).release();
+}
+
+// Returns the type hints of a function, as returned by `typing.get_type_hints`,
+// which resolves annotations written as strings. If they cannot be resolved,
+// returns an empty dictionary.
+::py::dict typeHints(const ::py::function& function)
+{
+  GILAcquire lock;
+  try
+  {
+    return ::py::module::import("typing").attr("get_type_hints")(function);
+  }
+  catch (const ::py::error_already_set& ex)
+  {
+    qiLogVerbose() << "Could not get the type hints of a function: " << ex.what();
+    return {};
+  }
+}
+
+// Returns the signature of the type that a PEP 484 annotation denotes.
+//
+// Booleans, integers, floats, strings and bytes have the signatures of the qi
+// types they are converted to. Lists, dictionaries, tuples and optionals
+// (including `typing.List`, `typing.Dict`, `typing.Tuple`, `typing.Optional`
+// and `T | None`) have the signatures of the corresponding qi containers of
+// the signatures of their arguments. Any other type is dynamic.
+std::string annotationSignature(const ::py::handle& annotation)
+{
+  GILAcquire lock;
+
+  const auto dynamic = std::string(1, Signature::Type_Dynamic);
+  const auto builtins = ::py::module::import("builtins");
+  if (annotation.is(builtins.attr("bool")))
+    return std::string(1, Signature::Type_Bool);
+  if (annotation.is(builtins.attr("int")))
+    return std::string(1, Signature::Type_Int64);
+  if (annotation.is(builtins.attr("float")))
+    return std::string(1, Signature::Type_Double);
+  if (annotation.is(builtins.attr("str")))
+    return std::string(1, Signature::Type_String);
+  if (annotation.is(builtins.attr("bytes")))
+    return std::string(1, Signature::Type_Raw);
+  if (annotation.is(builtins.attr("list")))
+    return std::string{ Signature::Type_List, Signature::Type_Dynamic, Signature::Type_List_End };
+  if (annotation.is(builtins.attr("dict")))
+    return std::string{ Signature::Type_Map, Signature::Type_Dynamic, Signature::Type_Dynamic,
+                        Signature::Type_Map_End };
+
+  // Generic types, such as `list[int]` or `typing.List[int]`, and unions, such
+  // as `typing.Optional[int]` or `int | None`, have an origin and arguments.
+  // The unions written with `|` have no `__origin__`, but `typing.get_origin`
+  // knows of them. It only exists since Python 3.8, whose unions all have an
+  // `__origin__`.
+  const auto typing = ::py::module::import("typing");
+  const auto hasGetOrigin = ::py::hasattr(typing, "get_origin");
+  const ::py::object origin = hasGetOrigin
+                                ? typing.attr("get_origin")(annotation)
+                                : ::py::getattr(annotation, "__origin__", ::py::none());
+  const ::py::tuple args = hasGetOrigin ? typing.attr("get_args")(annotation)
+                                        : ::py::getattr(annotation, "__args__", ::py::tuple());
+  if (origin.is_none())
+    return dynamic;
+  const auto noneType = builtins.attr("type")(::py::none());
+
+  if (origin.is(builtins.attr("list")) && args.size() == 1)
+    return Signature::Type_List + annotationSignature(args[0]) + Signature::Type_List_End;
+
+  if (origin.is(builtins.attr("dict")) && args.size() == 2)
+    return Signature::Type_Map + annotationSignature(args[0]) + annotationSignature(args[1])
+         + Signature::Type_Map_End;
+
+  if (origin.is(builtins.attr("tuple")))
+  {
+    // `tuple[T, ...]` is a homogeneous tuple of any size.
+    if (args.size() == 2 && args[1].is(::py::ellipsis()))
+      return Signature::Type_List + annotationSignature(args[0]) + Signature::Type_List_End;
+
+    std::string signature(1, Signature::Type_Tuple);
+    for (const auto& arg : args)
+    {
+      // The empty tuple is `tuple[()]`, whose argument is an empty tuple before
+      // Python 3.11.
+      if (PyTuple_Check(arg.ptr()) && ::py::len(arg) == 0)
+        continue;
+      signature += annotationSignature(arg);
+    }
+    return signature + Signature::Type_Tuple_End;
+  }
+
+  // `Optional[T]` is `Union[T, None]`, as is `T | None`, whose origin is
+  // `types.UnionType` since Python 3.10.
+  const auto unionType = ::py::getattr(::py::module::import("types"), "UnionType", ::py::none());
+  const auto isUnion = origin.is(typing.attr("Union"))
+                    || (!unionType.is_none() && origin.is(unionType));
+  if (isUnion && args.size() == 2)
+  {
+    const auto isNone = [&](const ::py::handle& arg) { return arg.is(noneType); };
+    if (isNone(args[1]))
+      return Signature::Type_Optional + annotationSignature(args[0]);
+    if (isNone(args[0]))
+      return Signature::Type_Optional + annotationSignature(args[1]);
+  }
+
+  return dynamic;
 }
 
 // Gets the default signature for a method.
@@ -181,9 +374,14 @@ AnyReference callPythonMethod(const AnyReferenceVector& cargs,
 // If the function takes variadic arguments (vargs), returns the signature of a
 // pure dynamic element, which indicates a generic function that takes anything.
 //
-// Otherwise, returns the signature of a function taking n Python objects, with n
-// the number of positional parameters the function accepts.
-std::string methodDefaultParametersSignature(const ::py::function& method)
+// Otherwise, returns the signature of a function taking n parameters, with n
+// the number of positional parameters the function accepts. The signature of a
+// parameter is derived from its type annotation (see `annotationSignature`),
+// and parameters without annotation are dynamic. The parameters annotated as
+// bytes are flagged in `bytesParameters`, as their raw arguments must be
+// converted to bytes.
+std::string methodDefaultParametersSignature(const ::py::function& method,
+                                             std::vector<bool>& bytesParameters)
 {
   GILAcquire lock;
 
@@ -214,11 +412,39 @@ std::string methodDefaultParametersSignature(const ::py::function& method)
     return kind.equal(positionalOnly) || kind.equal(positionalOrKeyword);
   };
 
-  const auto argsCount =
-    std::count_if(parameters.begin(), parameters.end(), isPositional);
-  return makeTupleSignature(
-           std::vector<TypeInterface*>(argsCount, typeOf<::py::object>()))
-    .toString();
+  const auto hints = typeHints(method);
+  const auto bytesType = ::py::module::import("builtins").attr("bytes");
+  std::string signature(1, Signature::Type_Tuple);
+  for (const auto& param : parameters)
+  {
+    if (!isPositional(param))
+      continue;
+    const auto hasHint = hints.contains(param.first);
+    bytesParameters.push_back(hasHint && hints[param.first].is(bytesType));
+    if (hasHint)
+      signature += annotationSignature(hints[param.first]);
+    else
+      signature += Signature::Type_Dynamic;
+  }
+  return signature + Signature::Type_Tuple_End;
+}
+
+// Gets the default return signature for a method, which is derived from its
+// return type annotation if it has one (see `annotationSignature`), with `None`
+// meaning that it returns nothing. Otherwise, the return value is dynamic.
+std::string methodDefaultReturnSignature(const ::py::function& method)
+{
+  GILAcquire lock;
+
+  const auto hints = typeHints(method);
+  if (!hints.contains("return"))
+    return std::string(1, Signature::Type_Dynamic);
+
+  const ::py::object annotation = hints["return"];
+  const auto noneType = ::py::module::import("builtins").attr("type")(::py::none());
+  if (annotation.is_none() || annotation.is(noneType))
+    return std::string(1, Signature::Type_Void);
+  return annotationSignature(annotation);
 }
 
 boost::optional<unsigned int> registerMethod(DynamicObjectBuilder& gob,
@@ -241,8 +467,9 @@ boost::optional<unsigned int> registerMethod(DynamicObjectBuilder& gob,
   if (desc)
     mmb.setDescription(::py::str(desc));
 
+  std::vector<bool> bytesParameters;
   if (parametersSignature.empty())
-    parametersSignature = methodDefaultParametersSignature(method);
+    parametersSignature = methodDefaultParametersSignature(method, bytesParameters);
   mmb.setParametersSignature(parametersSignature);
 
   std::string returnSignature;
@@ -251,7 +478,7 @@ boost::optional<unsigned int> registerMethod(DynamicObjectBuilder& gob,
     returnSignature = ::py::str(pyqiretsig);
 
   if (returnSignature.empty())
-    returnSignature = Signature::Type_Dynamic;
+    returnSignature = methodDefaultReturnSignature(method);
   mmb.setReturnSignature(returnSignature);
 
   qiLogVerbose() << "Registration of method " << name << " with signature "
@@ -259,7 +486,10 @@ boost::optional<unsigned int> registerMethod(DynamicObjectBuilder& gob,
 
   return gob.xAdvertiseMethod(mmb, AnyFunction::fromDynamicFunction(
                                      boost::bind(callPythonMethod, _1,
-                                                 SharedObject(method))));
+                                                 SharedObject(method),
+                                                 ConversionPlan::of(Signature(parametersSignature),
+                                                                    Signature(returnSignature)),
+                                                 std::move(bytesParameters))));
 }
 
 } // namespace
@@ -4,19 +4,34 @@
 */
 
 #include <utility>
+#include <array>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
 #include <tuple>
 #include <iterator>
+#include <limits>
+#include <map>
+#include <string_view>
+#include <unordered_map>
+#include <mutex>
+#include <memory>
 #include <qi/type/typedispatcher.hpp>
 #include <qi/type/typeinterface.hpp>
 #include <qi/numeric.hpp>
 #include <qi/assert.hpp>
+#include <qi/log.hpp>
 #include <qipython/common.hpp>
 #include <qipython/pyguard.hpp>
 #include <qipython/pytypes.hpp>
 #include <qipython/pyfuture.hpp>
 #include <qipython/pyobject.hpp>
+#include <qipython/pybuffer.hpp>
+#include <qipython/pyview.hpp>
 #include <pybind11/pybind11.h>
-#include <boost/thread/synchronized_value.hpp>
+
+qiLogCategory("qi.python.types");
 
 namespace py = pybind11;
 
@@ -37,6 +52,718 @@ boost::optional<::py::object> tryToCastObjectTo(ObjectTypeInterface* type,
   return castToPyObject(reinterpret_cast<T*>(ptr), ::py::return_value_policy::copy);
 }
 
+enum class TextEncoding
+{
+  Ascii,
+  Utf8,
+  Invalid,
+};
+
+/// Returns whether a characters sequence is ASCII data, other valid UTF-8 data
+/// or invalid UTF-8 data. Valid UTF-8 data is well-formed as defined by the
+/// Unicode standard, which is what the strict UTF-8 decoder of Python accepts:
+/// overlong forms, surrogates and code points above U+10FFFF are invalid.
+TextEncoding textEncodingOf(const char* data, std::size_t len)
+{
+  using Word = std::uint64_t;
+  constexpr Word highBits = 0x8080808080808080ull;
+
+  const auto bytes = reinterpret_cast<const unsigned char*>(data);
+  auto encoding = TextEncoding::Ascii;
+  std::size_t i = 0;
+  while (i < len)
+  {
+    // ASCII characters are skipped a word at a time.
+    for (; len - i >= sizeof(Word); i += sizeof(Word))
+    {
+      Word word;
+      std::memcpy(&word, bytes + i, sizeof(Word));
+      if (word & highBits)
+        break;
+    }
+    while (i < len && bytes[i] < 0x80)
+      ++i;
+    if (i == len)
+      break;
+
+    // Bounds of the first continuation byte and count of continuation bytes,
+    // depending on the leading byte.
+    const auto lead = bytes[i];
+    unsigned char low = 0x80;
+    unsigned char high = 0xbf;
+    std::size_t count = 0;
+    if (lead >= 0xc2 && lead <= 0xdf)
+      count = 1;
+    else if (lead >= 0xe0 && lead <= 0xef)
+    {
+      count = 2;
+      if (lead == 0xe0)
+        low = 0xa0;
+      else if (lead == 0xed)
+        high = 0x9f;
+    }
+    else if (lead >= 0xf0 && lead <= 0xf4)
+    {
+      count = 3;
+      if (lead == 0xf0)
+        low = 0x90;
+      else if (lead == 0xf4)
+        high = 0x8f;
+    }
+    else
+      return TextEncoding::Invalid;
+
+    if (len - i - 1 < count || bytes[i + 1] < low || bytes[i + 1] > high)
+      return TextEncoding::Invalid;
+    for (std::size_t k = 2; k <= count; ++k)
+    {
+      if ((bytes[i + k] & 0xc0) != 0x80)
+        return TextEncoding::Invalid;
+    }
+    i += count + 1;
+    encoding = TextEncoding::Utf8;
+  }
+  return encoding;
+}
+
+/// Converts a characters sequence to a Python string, or to Python bytes if it
+/// is not valid UTF-8 data.
+///
+/// The encoding of the data is checked before any object is constructed,
+/// rather than by attempting the construction of a string, because a failed
+/// attempt costs a Python error and a C++ exception. ASCII data, which is the
+/// most common, is copied as is in a compact string without being decoded.
+///
+/// @pre The GIL is locked.
+::py::object stringToPyObject(const char* data, std::size_t len)
+{
+  const auto size = static_cast<Py_ssize_t>(len);
+  switch (textEncodingOf(data, len))
+  {
+    case TextEncoding::Ascii:
+    {
+      auto obj = ::py::reinterpret_steal<::py::str>(PyUnicode_New(size, 127));
+      if (!obj)
+        throw ::py::error_already_set();
+      std::memcpy(PyUnicode_1BYTE_DATA(obj.ptr()), data, len);
+      return std::move(obj);
+    }
+    case TextEncoding::Utf8:
+    {
+      auto obj = ::py::reinterpret_steal<::py::str>(PyUnicode_FromStringAndSize(data, size));
+      if (!obj)
+        throw ::py::error_already_set();
+      return std::move(obj);
+    }
+    case TextEncoding::Invalid:
+      break;
+  }
+  return ::py::bytes(data, len);
+}
+
+/// Cache of interned Python strings for the keys of maps and the names of the
+/// fields of structures. Values tend to have the same few keys, so the same
+/// strings are reused instead of being constructed for each value. As they are
+/// interned, they are also quickly hashed and compared by dictionaries.
+///
+/// Only short keys are cached, and only up to a number of keys, so that maps
+/// with arbitrary keys do not make the cache grow unbounded.
+///
+/// The cache is protected by the GIL: none of its operations releases it while
+/// the cached keys are read or modified.
+class InternedKeys
+{
+public:
+  static constexpr std::size_t maxKeySize = 64;
+  static constexpr std::size_t capacity = 4096;
+
+  /// Returns the Python object of a key, as `stringToPyObject` would.
+  ///
+  /// @pre The GIL is locked.
+  ::py::object get(const char* data, std::size_t len)
+  {
+    if (len > maxKeySize)
+      return stringToPyObject(data, len);
+
+    const auto it = _keys.find(std::string_view(data, len));
+    if (it != _keys.end())
+      return it->second;
+
+    auto obj = stringToPyObject(data, len);
+    if (!PyUnicode_CheckExact(obj.ptr()) || _keys.size() >= capacity)
+      return obj;
+
+    auto ptr = obj.release().ptr();
+    PyUnicode_InternInPlace(&ptr);
+    obj = ::py::reinterpret_steal<::py::object>(ptr);
+
+    // The view of a cached key is the UTF-8 data of its string, which lives as
+    // long as the string.
+    Py_ssize_t size = 0;
+    const auto utf8 = PyUnicode_AsUTF8AndSize(ptr, &size);
+    if (!utf8)
+      throw ::py::error_already_set();
+    return _keys.emplace(std::string_view(utf8, static_cast<std::size_t>(size)),
+                         std::move(obj)).first->second;
+  }
+
+  /// @pre The GIL is locked.
+  void clear()
+  {
+    _keys.clear();
+  }
+
+private:
+  std::unordered_map<std::string_view, ::py::object> _keys;
+};
+
+/// Returns the cache of interned keys. It is never destroyed, as its keys
+/// cannot be released once the interpreter is finalized. It is cleared at the
+/// exit of the interpreter instead.
+InternedKeys& internedKeys()
+{
+  static auto* const keys = new InternedKeys();
+  return *keys;
+}
+
+/// Converts the key of a map to a Python object, through the cache of interned
+/// keys if it is a string.
+///
+/// @pre The GIL is locked.
+::py::object keyToPyObject(AnyReference key)
+{
+  if (key.kind() != TypeKind_String)
+    return unwrapValue(key);
+
+  const auto managedStr = static_cast<StringTypeInterface*>(key.type())->get(key.rawValue());
+  const auto& str = managedStr.first;
+  auto obj = internedKeys().get(str.first ? str.first : "", str.second);
+  if (managedStr.second)
+    managedStr.second(str);
+  return obj;
+}
+
+/// Returns a new empty Python dict, presized for a number of items when
+/// possible, so that it is not resized while they are inserted.
+///
+/// @pre The GIL is locked.
+::py::dict newPyDict(std::size_t size)
+{
+#if PY_VERSION_HEX < 0x030D0000
+  // `_PyDict_NewPresized` is private to CPython, so it is only used with the
+  // versions known to export it.
+  auto dict = ::py::reinterpret_steal<::py::dict>(
+    _PyDict_NewPresized(static_cast<Py_ssize_t>(size)));
+#else
+  static_cast<void>(size);
+  auto dict = ::py::reinterpret_steal<::py::dict>(PyDict_New());
+#endif
+  if (!dict)
+    throw ::py::error_already_set();
+  return dict;
+}
+
+/// @pre The GIL is locked.
+void setPyDictItem(const ::py::dict& dict, const ::py::object& key, const ::py::object& value)
+{
+  if (PyDict_SetItem(dict.ptr(), key.ptr(), value.ptr()) != 0)
+    throw ::py::error_already_set();
+}
+
+/// Converts a map to a Python dict presized for its number of elements.
+///
+/// @pre The GIL is locked.
+::py::dict mapToPyDict(AnyReference map)
+{
+  auto dict = newPyDict(map.size());
+  const auto end = map.end();
+  for (auto it = map.begin(); it != end; ++it)
+  {
+    const auto pair = *it;
+    setPyDictItem(dict, keyToPyObject(pair[0]), unwrapValue(pair[1]));
+  }
+  return dict;
+}
+
+/// Returns a new Python list of a size, whose items are the objects that a
+/// function returns for each index.
+///
+/// Function<PyObject* (std::size_t)> F
+/// The function returns a new reference, or null if it failed, in which case
+/// a Python error is set.
+///
+/// @pre The GIL is locked.
+template<typename F>
+::py::list newPyList(std::size_t size, F&& makeItem)
+{
+  auto list = ::py::reinterpret_steal<::py::list>(PyList_New(static_cast<Py_ssize_t>(size)));
+  if (!list)
+    throw ::py::error_already_set();
+  for (std::size_t i = 0; i < size; ++i)
+  {
+    const auto item = makeItem(i);
+    if (!item)
+      throw ::py::error_already_set();
+    PyList_SET_ITEM(list.ptr(), static_cast<Py_ssize_t>(i), item);
+  }
+  return list;
+}
+
+/// Converts a value of a primitive type to a new reference to a Python object,
+/// as `ValueToPyObject` does, but without dispatching on its type.
+///
+/// @pre The kind of the type is either `TypeKind_Int`, `TypeKind_Float` or
+///      `TypeKind_String`.
+/// @pre The GIL is locked.
+PyObject* primitiveToPyObject(TypeInterface* type, void* storage)
+{
+  switch (type->kind())
+  {
+    case TypeKind_Int:
+    {
+      auto* const intType = static_cast<IntTypeInterface*>(type);
+      const auto value = intType->get(storage);
+      // The size is 0 when the value is a boolean.
+      if (intType->size() == 0)
+        return PyBool_FromLong(value != 0);
+      return intType->isSigned() ? PyLong_FromLongLong(value)
+                                 : PyLong_FromUnsignedLongLong(static_cast<std::uint64_t>(value));
+    }
+    case TypeKind_Float:
+      return PyFloat_FromDouble(static_cast<FloatTypeInterface*>(type)->get(storage));
+    case TypeKind_String:
+    {
+      const auto managedStr = static_cast<StringTypeInterface*>(type)->get(storage);
+      const auto& str = managedStr.first;
+      auto obj = str.first ? stringToPyObject(str.first, str.second) : ::py::str("");
+      if (managedStr.second)
+        managedStr.second(str);
+      return obj.release().ptr();
+    }
+    default:
+      throw std::runtime_error("cannot convert a value of a non primitive type as a primitive");
+  }
+}
+
+/// Converts a `std::vector` of a type to a Python list, by reading its elements
+/// directly, if the value is such a vector.
+///
+/// Function<PyObject* (const T&)> F
+///
+/// @pre The GIL is locked.
+template<typename T, typename F>
+boost::optional<::py::list> tryVectorToPyList(AnyReference value, F&& makeItem)
+{
+  if (value.type()->info() != typeOf<std::vector<T>>()->info())
+    return {};
+
+  auto storage = value.rawValue();
+  const auto& vec = *static_cast<const std::vector<T>*>(value.type()->ptrFromStorage(&storage));
+  return newPyList(vec.size(), [&](std::size_t i) { return makeItem(vec[i]); });
+}
+
+/// Converts a list whose elements are of a primitive type (integers, floating
+/// point numbers or strings) to a Python list, if the value is such a list.
+///
+/// The Python list is allocated with its final size and its items are directly
+/// constructed, without dispatching on the type of each element. The most
+/// common vectors are read directly from their contiguous storage.
+///
+/// @pre The GIL is locked.
+boost::optional<::py::list> tryHomogeneousListToPyList(AnyReference value)
+{
+  if (value.kind() != TypeKind_List)
+    return {};
+
+  auto* const elementType = static_cast<ListTypeInterface*>(value.type())->elementType();
+  const auto elementKind = elementType->kind();
+  if (elementKind != TypeKind_Int && elementKind != TypeKind_Float
+      && elementKind != TypeKind_String)
+    return {};
+
+  const auto fromDouble = [](double d) { return PyFloat_FromDouble(d); };
+  const auto fromSigned = [](std::int64_t i) { return PyLong_FromLongLong(i); };
+  const auto fromUnsigned = [](std::uint64_t i) { return PyLong_FromUnsignedLongLong(i); };
+  const auto fromString = [](const std::string& str) {
+    return stringToPyObject(str.data(), str.size()).release().ptr();
+  };
+  if (auto list = tryVectorToPyList<double>(value, fromDouble)) return list;
+  if (auto list = tryVectorToPyList<float>(value, fromDouble)) return list;
+  if (auto list = tryVectorToPyList<std::int32_t>(value, fromSigned)) return list;
+  if (auto list = tryVectorToPyList<std::int64_t>(value, fromSigned)) return list;
+  if (auto list = tryVectorToPyList<std::uint32_t>(value, fromUnsigned)) return list;
+  if (auto list = tryVectorToPyList<std::uint64_t>(value, fromUnsigned)) return list;
+  if (auto list = tryVectorToPyList<std::string>(value, fromString)) return list;
+
+  // Other lists are traversed with their iterators.
+  auto it = value.begin();
+  const auto end = value.end();
+  auto list = newPyList(value.size(), [&](std::size_t) -> PyObject* {
+    if (it == end)
+      throw std::runtime_error("the size of a list changed during its conversion");
+    auto obj = primitiveToPyObject(elementType, (*it).rawValue());
+    ++it;
+    return obj;
+  });
+  return list;
+}
+
+std::atomic<bool> numpyArrayConversionGloballyEnabled{ false };
+thread_local boost::optional<bool> numpyArrayConversionEnabledInThread;
+
+template<typename T>
+struct TypeTag
+{
+  using type = T;
+};
+
+/// Kind of a Python object whose type is exactly a primitive type, with a
+/// corresponding static qi type.
+enum class PrimitiveKind
+{
+  None,
+  Bool,
+  Int,
+  Float,
+  Str,
+};
+
+PrimitiveKind primitiveKindOf(PyObject* obj)
+{
+  const auto type = Py_TYPE(obj);
+  if (type == &PyBool_Type)
+    return PrimitiveKind::Bool;
+  if (type == &PyLong_Type)
+    return PrimitiveKind::Int;
+  if (type == &PyFloat_Type)
+    return PrimitiveKind::Float;
+  if (type == &PyUnicode_Type)
+    return PrimitiveKind::Str;
+  return PrimitiveKind::None;
+}
+
+/// Invokes a function with the tag of the arithmetic type of the values of an
+/// integer or floating point number type and returns its result, or returns
+/// nothing for other types. Booleans, whose size is 0, have no arithmetic type.
+template<typename F>
+auto invokeWithArithmeticTypeOf(TypeInterface* type, F&& f)
+  -> boost::optional<decltype(f(TypeTag<double>{}))>
+{
+  switch (type->kind())
+  {
+    case TypeKind_Float:
+      if (static_cast<FloatTypeInterface*>(type)->size() == sizeof(float))
+        return f(TypeTag<float>{});
+      return f(TypeTag<double>{});
+    case TypeKind_Int:
+    {
+      auto* const intType = static_cast<IntTypeInterface*>(type);
+      const auto isSigned = intType->isSigned();
+      switch (intType->size())
+      {
+        case 1: return isSigned ? f(TypeTag<std::int8_t>{}) : f(TypeTag<std::uint8_t>{});
+        case 2: return isSigned ? f(TypeTag<std::int16_t>{}) : f(TypeTag<std::uint16_t>{});
+        case 4: return isSigned ? f(TypeTag<std::int32_t>{}) : f(TypeTag<std::uint32_t>{});
+        case 8: return isSigned ? f(TypeTag<std::int64_t>{}) : f(TypeTag<std::uint64_t>{});
+        default: return {};
+      }
+    }
+    default:
+      return {};
+  }
+}
+
+/// Returns a new one-dimensional numpy array of an arithmetic type and a pointer
+/// to its data.
+///
+/// @pre The GIL is locked.
+template<typename T>
+std::pair<::py::object, T*> newNumpyArray(std::size_t size)
+{
+  const auto numpy = ::py::module::import("numpy");
+  auto array = numpy.attr("empty")(size, ::py::arg("dtype") = ::py::format_descriptor<T>::format());
+  const auto info = ::py::buffer(array).request(/* writable = */ true);
+  return { std::move(array), static_cast<T*>(info.ptr) };
+}
+
+/// Converts a list of an arithmetic type to a numpy array of that type. The
+/// data of vectors is copied at once, the elements of other lists are read
+/// through the interface of their type.
+///
+/// @pre The kind of the element type is either `TypeKind_Int` or
+///      `TypeKind_Float`.
+/// @pre The GIL is locked.
+template<typename T>
+::py::object numericListToNumpyArray(AnyReference value, TypeInterface* elementType)
+{
+  if (value.type()->info() == typeOf<std::vector<T>>()->info())
+  {
+    auto storage = value.rawValue();
+    const auto& vec = *static_cast<const std::vector<T>*>(value.type()->ptrFromStorage(&storage));
+    auto array = newNumpyArray<T>(vec.size());
+    std::copy(vec.begin(), vec.end(), array.second);
+    return std::move(array.first);
+  }
+
+  const auto size = value.size();
+  auto array = newNumpyArray<T>(size);
+  const auto isFloat = elementType->kind() == TypeKind_Float;
+  std::size_t i = 0;
+  const auto end = value.end();
+  for (auto it = value.begin(); it != end; ++it, ++i)
+  {
+    if (i == size)
+      throw std::runtime_error("the size of a list changed during its conversion");
+    const auto storage = (*it).rawValue();
+    array.second[i] = isFloat ? static_cast<T>(static_cast<FloatTypeInterface*>(elementType)->get(storage))
+                              : static_cast<T>(static_cast<IntTypeInterface*>(elementType)->get(storage));
+  }
+  return std::move(array.first);
+}
+
+/// Converts a list of integers or floating point numbers to a one-dimensional
+/// numpy array of the corresponding data type, if the value is such a list.
+/// Lists of booleans are not converted.
+///
+/// @pre The GIL is locked.
+boost::optional<::py::object> tryNumericListToNumpyArray(AnyReference value)
+{
+  if (value.kind() != TypeKind_List)
+    return {};
+
+  auto* const elementType = static_cast<ListTypeInterface*>(value.type())->elementType();
+  return invokeWithArithmeticTypeOf(elementType, [&](auto tag) {
+    return numericListToNumpyArray<typename decltype(tag)::type>(value, elementType);
+  });
+}
+
+std::atomic<bool> columnarConversionGloballyEnabled{ false };
+thread_local boost::optional<bool> columnarConversionEnabledInThread;
+
+/// Column of the values of a member of the structures of a list.
+class Column
+{
+public:
+  virtual ~Column() = default;
+
+  /// Adds the value of the member of a structure, without the GIL.
+  virtual void add(void* memberStorage) = 0;
+
+  /// @pre The GIL is locked.
+  virtual ::py::object toPyObject() const = 0;
+};
+
+/// Column of integers or floating point numbers, which becomes a numpy array
+/// if the conversion of numeric lists to numpy arrays is enabled, or an
+/// `array.array` otherwise.
+template<typename T>
+class ArithmeticColumn : public Column
+{
+public:
+  ArithmeticColumn(TypeInterface* memberType, std::size_t capacity)
+    : _memberType(memberType)
+    , _isFloat(memberType->kind() == TypeKind_Float)
+  {
+    _values.reserve(capacity);
+  }
+
+  void add(void* memberStorage) override
+  {
+    _values.push_back(
+      _isFloat ? static_cast<T>(static_cast<FloatTypeInterface*>(_memberType)->get(memberStorage))
+               : static_cast<T>(static_cast<IntTypeInterface*>(_memberType)->get(memberStorage)));
+  }
+
+  ::py::object toPyObject() const override
+  {
+    if (numpyArrayConversionEnabled())
+    {
+      auto array = newNumpyArray<T>(_values.size());
+      std::copy(_values.begin(), _values.end(), array.second);
+      return std::move(array.first);
+    }
+
+    auto array = ::py::module::import("array").attr("array")(::py::format_descriptor<T>::format());
+    if (_values.empty())
+      return array;
+
+    const auto data = ::py::reinterpret_steal<::py::object>(PyMemoryView_FromMemory(
+      const_cast<char*>(reinterpret_cast<const char*>(_values.data())),
+      static_cast<Py_ssize_t>(_values.size() * sizeof(T)), PyBUF_READ));
+    if (!data)
+      throw ::py::error_already_set();
+    array.attr("frombytes")(data);
+    return array;
+  }
+
+private:
+  TypeInterface* _memberType;
+  bool _isFloat;
+  std::vector<T> _values;
+};
+
+/// Column of values of any other type, which becomes a list of their
+/// conversions. The values are referenced in the structures of the list.
+class ValueColumn : public Column
+{
+public:
+  ValueColumn(TypeInterface* memberType, std::size_t capacity)
+    : _memberType(memberType)
+  {
+    _members.reserve(capacity);
+  }
+
+  void add(void* memberStorage) override
+  {
+    _members.push_back(memberStorage);
+  }
+
+  ::py::object toPyObject() const override
+  {
+    return newPyList(_members.size(), [&](std::size_t i) {
+      return unwrapValue(AnyReference(_memberType, _members[i])).release().ptr();
+    });
+  }
+
+private:
+  TypeInterface* _memberType;
+  std::vector<void*> _members;
+};
+
+std::unique_ptr<Column> makeColumn(TypeInterface* memberType, std::size_t capacity)
+{
+  auto column = invokeWithArithmeticTypeOf(memberType, [&](auto tag) -> std::unique_ptr<Column> {
+    using T = typename decltype(tag)::type;
+    return std::make_unique<ArithmeticColumn<T>>(memberType, capacity);
+  });
+  if (column)
+    return std::move(*column);
+  return std::make_unique<ValueColumn>(memberType, capacity);
+}
+
+/// Converts a list of structures to a dictionary of the columns of their
+/// members, if the value is such a list. Columns are keyed by the names of
+/// the members, or by their indices if the structures have no names.
+///
+/// The members are gathered in a single traversal of the list with the GIL
+/// released, which is then only locked to create the columns.
+///
+/// @pre The GIL is locked.
+boost::optional<::py::object> tryStructListToColumns(AnyReference value)
+{
+  if (value.kind() != TypeKind_List)
+    return {};
+
+  auto* const elementType = static_cast<ListTypeInterface*>(value.type())->elementType();
+  if (elementType->kind() != TypeKind_Tuple)
+    return {};
+
+  auto* const structType = static_cast<StructTypeInterface*>(elementType);
+  const auto memberTypes = structType->memberTypes();
+  const auto size = value.size();
+  std::vector<std::unique_ptr<Column>> columns;
+  columns.reserve(memberTypes.size());
+  for (auto* const memberType : memberTypes)
+    columns.push_back(makeColumn(memberType, size));
+
+  {
+    GILRelease unlock;
+    const auto end = value.end();
+    for (auto it = value.begin(); it != end; ++it)
+    {
+      const auto elementStorage = (*it).rawValue();
+      for (std::size_t i = 0; i < columns.size(); ++i)
+        columns[i]->add(structType->get(elementStorage, static_cast<unsigned int>(i)));
+    }
+  }
+
+  const auto names = structType->elementsName();
+  const auto hasNames = names.size() == columns.size();
+  auto dict = newPyDict(columns.size());
+  for (std::size_t i = 0; i < columns.size(); ++i)
+  {
+    const auto key = hasNames
+                       ? ::py::object(internedKeys().get(names[i].data(), names[i].size()))
+                       : ::py::object(::py::int_(i));
+    setPyDictItem(dict, key, columns[i]->toPyObject());
+  }
+  return ::py::object(std::move(dict));
+}
+
+/// Python class registered as a structure type: a dataclass or a NamedTuple
+/// class, whose fields are the members of the structure.
+struct StructClass
+{
+  ::py::object cls;
+  std::string name;
+  std::vector<std::string> fieldNames;
+  TypeInterface* type;
+
+  /// Returns whether the names are the names of the fields, in any order.
+  bool hasFields(const std::vector<std::string>& names) const
+  {
+    return std::is_permutation(names.begin(), names.end(),
+                               fieldNames.begin(), fieldNames.end());
+  }
+};
+
+/// Registry of the structure classes, by class and by name. A class that is
+/// registered again, or another class registered with the same name, replaces
+/// the previous registration.
+///
+/// The registry is protected by the GIL.
+class StructClasses
+{
+public:
+  using Ptr = std::shared_ptr<const StructClass>;
+
+  /// @pre The GIL is locked.
+  Ptr find(PyTypeObject* cls) const
+  {
+    const auto it = _byClass.find(cls);
+    return it == _byClass.end() ? nullptr : it->second;
+  }
+
+  /// @pre The GIL is locked.
+  Ptr find(const std::string& name) const
+  {
+    const auto it = _byName.find(name);
+    return it == _byName.end() ? nullptr : it->second;
+  }
+
+  /// @pre The GIL is locked.
+  void add(Ptr structClass)
+  {
+    const auto cls = reinterpret_cast<PyTypeObject*>(structClass->cls.ptr());
+    if (const auto previous = find(cls))
+      _byName.erase(previous->name);
+    if (const auto previous = find(structClass->name))
+      _byClass.erase(reinterpret_cast<PyTypeObject*>(previous->cls.ptr()));
+    _byClass[cls] = structClass;
+    _byName[structClass->name] = std::move(structClass);
+  }
+
+  /// @pre The GIL is locked.
+  void clear()
+  {
+    _byClass.clear();
+    _byName.clear();
+  }
+
+private:
+  std::unordered_map<PyTypeObject*, Ptr> _byClass;
+  std::unordered_map<std::string, Ptr> _byName;
+};
+
+/// Returns the registry of structure classes. It is never destroyed, as its
+/// classes cannot be released once the interpreter is finalized. It is cleared
+/// at the exit of the interpreter instead.
+StructClasses& structClasses()
+{
+  static auto* const classes = new StructClasses();
+  return *classes;
+}
+
 struct ValueToPyObject
 {
   // @pre: The GIL is locked.
@@ -85,29 +812,7 @@ struct ValueToPyObject
       return;
     }
 
-    // Python strings are Unicode, and trying to construct one with a characters
-    // sequence that is not valid UTF-8 data results in an exception in
-    // pybind11. So if we can't create a Python `string` due to an exception, we
-    // try to create a Python `bytes` instead.
-    const auto toUnicode = [&] {
-      const auto obj = ::py::reinterpret_steal<::py::str>(
-        PyUnicode_FromStringAndSize(data, static_cast<ssize_t>(len)));
-      // When it fails, the conversion may set a Python error. We need to handle
-      // it by throwing `error_already_set`.
-      if (!obj)
-      {
-        if (PyErr_Occurred())
-          throw ::py::error_already_set();
-        else
-          throw std::runtime_error("failed to construct a Python string from data");
-      }
-      return obj;
-    };
-    const auto toBytes = [&] { return ::py::bytes(data, len); };
-
-    using namespace ka::functional_ops;
-    const auto thenToBytes = ka::constant_function() | toBytes;
-    result = ka::invoke_catch(thenToBytes, toUnicode);
+    result = stringToPyObject(data, len);
   }
 
   void visitList(AnyIterator it, AnyIterator end)
@@ -129,7 +834,7 @@ struct ValueToPyObject
     GILAcquire lock;
     ::py::dict d;
     for (; it != end; ++it)
-      d[unwrapValue((*it)[0])] = (*it)[1];
+      setPyDictItem(d, keyToPyObject((*it)[0]), unwrapValue((*it)[1]));
     result = d;
   }
 
@@ -167,7 +872,7 @@ struct ValueToPyObject
     throw std::runtime_error("cannot convert a pointer to a Python object");
   }
 
-  void visitTuple(const std::string& /*name*/,
+  void visitTuple(const std::string& name,
                   const std::vector<AnyReference>& tuple,
                   const std::vector<std::string>& annotations)
   {
@@ -185,143 +890,575 @@ struct ValueToPyObject
     else
     {
       QI_ASSERT_TRUE(annotations.size() <= tuple.size());
-      ::py::dict d;
+      auto d = newPyDict(annotations.size());
       for (std::size_t i = 0; i < annotations.size(); ++i)
-        d[annotations.at(i).c_str()] = tuple[i];
+      {
+        const auto& fieldName = annotations.at(i);
+        setPyDictItem(d, internedKeys().get(fieldName.data(), fieldName.size()),
+                      unwrapValue(tuple[i]));
+      }
+
+      // Structures of a registered class are instances of that class, which
+      // are constructed with their fields as keyword arguments.
+      const auto structClass = structClasses().find(name);
+      if (structClass && structClass->hasFields(annotations))
+      {
+        result = structClass->cls(**d);
+        return;
+      }
       result = d;
     }
   }
 
-  void visitDynamic(AnyReference pointee)
+  void visitDynamic(AnyReference pointee)
+  {
+    GILAcquire lock;
+    result = unwrapValue(pointee);
+  }
+
+  void visitRaw(AnyReference value)
+  {
+    GILAcquire lock;
+    result = rawToMemoryView(value);
+  }
+
+  void visitIterator(AnyReference v)
+  {
+    visitUnknown(v);
+  }
+
+  void visitOptional(AnyReference v)
+  {
+    GILAcquire lock;
+    result = unwrapValue(v.content());
+  }
+
+  ::py::object& result;
+};
+
+/// Singleton for a default constructible type.
+template<typename T>
+T* instance()
+{
+  static T instance;
+  return &instance;
+}
+
+/// Instances of a type constructible from a size, one per size, found without
+/// locking.
+///
+/// Instances of small sizes are in a preallocated table. Larger ones are in
+/// buckets of growing capacity, allocated on first use: bucket `b` holds the
+/// instances of `smallSizeCount * 2^b` consecutive sizes. Instances are created
+/// on first use too. If threads race to create the same instance or bucket,
+/// all of them but one discard theirs.
+template<typename T>
+class SizedInstances
+{
+public:
+  SizedInstances()
+  {
+    _buckets[0].store(_small.data(), std::memory_order_relaxed);
+  }
+
+  ~SizedInstances()
+  {
+    for (std::size_t b = 0; b < bucketCount; ++b)
+    {
+      auto* const bucket = _buckets[b].load(std::memory_order_acquire);
+      if (!bucket)
+        continue;
+      for (std::size_t i = 0; i < capacityOf(b); ++i)
+        delete bucket[i].load(std::memory_order_acquire);
+      if (b != 0)
+        delete[] bucket;
+    }
+  }
+
+  SizedInstances(const SizedInstances&) = delete;
+  SizedInstances& operator=(const SizedInstances&) = delete;
+
+  T* get(std::size_t size)
+  {
+    auto& slot = slotOf(size);
+    if (auto* const inst = slot.load(std::memory_order_acquire))
+      return inst;
+    return publish(slot, std::make_unique<T>(size));
+  }
+
+private:
+  using Slot = std::atomic<T*>;
+
+  static constexpr std::size_t smallSizeCount = 32;
+  static constexpr std::size_t bucketCount = std::numeric_limits<std::size_t>::digits;
+
+  static std::size_t capacityOf(std::size_t bucket)
+  {
+    return smallSizeCount << bucket;
+  }
+
+  Slot& slotOf(std::size_t size)
+  {
+    // Bucket `b` begins at `smallSizeCount * (2^b - 1)`, therefore the bucket
+    // of a size is the index of the highest bit of `size / smallSizeCount + 1`.
+    std::size_t bucket = 0;
+    for (auto n = size / smallSizeCount + 1; n > 1; n >>= 1)
+      ++bucket;
+    const auto offset = size - smallSizeCount * ((std::size_t(1) << bucket) - 1);
+    return bucketOf(bucket)[offset];
+  }
+
+  Slot* bucketOf(std::size_t b)
+  {
+    auto* bucket = _buckets[b].load(std::memory_order_acquire);
+    if (bucket)
+      return bucket;
+
+    std::unique_ptr<Slot[]> newBucket(new Slot[capacityOf(b)]());
+    if (_buckets[b].compare_exchange_strong(bucket, newBucket.get(),
+                                            std::memory_order_acq_rel))
+      return newBucket.release();
+    return bucket;
+  }
+
+  static T* publish(Slot& slot, std::unique_ptr<T> newInst)
+  {
+    T* inst = nullptr;
+    if (slot.compare_exchange_strong(inst, newInst.get(), std::memory_order_acq_rel))
+      return newInst.release();
+    return inst;
+  }
+
+  std::array<Slot, smallSizeCount> _small{};
+  std::array<std::atomic<Slot*>, bucketCount> _buckets{};
+};
+
+/// Singleton for a type constructible from a size, such as the interface of a
+/// structure of that number of members. The lookup does not lock, so that
+/// concurrent conversions do not contend on it.
+template<typename T>
+T* sizedInstance(std::size_t size)
+{
+  static SizedInstances<T> instances;
+  return instances.get(size);
+}
+
+detail::DisownedReferencesStorage::References unstoreDisownedReferences(void* context) noexcept
+{
+  return instance<detail::DisownedReferencesStorage>()->unstore(context);
+}
+
+/// Stores a disowned reference at a slot of the context, unless one is already
+/// stored there. See `detail::DisownedReferencesStorage::storeOnceAt`.
+template<typename Make>
+AnyReference storeDisownedReferenceOnceAt(void* context, std::uintptr_t slot, Make&& make)
+{
+  return instance<detail::DisownedReferencesStorage>()->storeOnceAt(
+    context, slot, std::forward<Make>(make));
+}
+
+/// Returns the Python object that a reference of a Python object type refers
+/// to.
+PyObject* pyObjectOf(AnyReference ref)
+{
+  auto storage = ref.rawValue();
+  return static_cast<::py::object*>(ref.type()->ptrFromStorage(&storage))->ptr();
+}
+
+/// Returns the Python object that a member of a reference of a tuple of Python
+/// objects refers to.
+PyObject* pyObjectOfMember(AnyReference tupleRef, unsigned int index)
+{
+  auto* const tupleType = static_cast<StructTypeInterface*>(tupleRef.type());
+  auto storage = tupleType->get(tupleRef.rawValue(), index);
+  return static_cast<::py::object*>(
+           tupleType->memberTypes().at(index)->ptrFromStorage(&storage))->ptr();
+}
+
+/// Returns the references to the elements of a container of a size, which
+/// reads of the container that are not traversals share. See
+/// `detail::DisownedReferencesStorage::elementReferences`.
+std::shared_ptr<detail::ElementReferences> elementReferencesOf(void* containerStorage,
+                                                               std::size_t containerSize)
+{
+  return instance<detail::DisownedReferencesStorage>()->elementReferences(containerStorage,
+                                                                          containerSize);
+}
+
+/// Returns a reference of a type to an element of a container, stored at a
+/// slot of the references to the elements of the container.
+///
+/// The reference is reused by later reads of the same slot for as long as the
+/// element is the same object of the same type. Otherwise, a new reference is
+/// made, and the previous one is kept with the others, as readers may still be
+/// using it.
+///
+/// @pre `type` is the interface of a type whose storage is a `pybind11::object`.
+/// @pre The GIL is locked.
+AnyReference elementReference(detail::ElementReferences& references, std::uintptr_t slot,
+                              PyObject* element, TypeInterface* type = typeOf<::py::object>())
+{
+  return references.at(
+    slot,
+    [&](AnyReference ref) { return ref.type() == type && pyObjectOf(ref) == element; },
+    [&] {
+      auto elementObj = ::py::reinterpret_borrow<::py::object>(element);
+      return AnyReference(type, type->clone(&elementObj));
+    });
+}
+
+std::size_t destroyDisownedReferences(void* context) noexcept
+{
+  auto refs = unstoreDisownedReferences(context);
+  std::size_t count = 0;
+  for (auto& slotRef : refs.slots)
+  {
+    if (slotRef.second.isValid())
+    {
+      slotRef.second.destroy();
+      ++count;
+    }
+  }
+  // The element references are only destroyed once the readers that still
+  // hold them are done.
+  refs.elements.reset();
+  return count;
+}
+
+/// Returns whether the object exports its data as a single contiguous buffer.
+///
+/// @pre The GIL is locked.
+bool hasContiguousBuffer(const ::py::object& obj)
+{
+  if (!PyObject_CheckBuffer(obj.ptr()))
+    return false;
+
+  Py_buffer view;
+  if (PyObject_GetBuffer(obj.ptr(), &view, PyBUF_SIMPLE) != 0)
+  {
+    PyErr_Clear();
+    return false;
+  }
+  PyBuffer_Release(&view);
+  return true;
+}
+
+/// Slot of the references to the elements of a storage at which the export of
+/// the buffer of its object is stored.
+constexpr std::uintptr_t bufferExportSlot = std::numeric_limits<std::uintptr_t>::max() - 2;
+
+/// Returns the buffer that the object of a storage exports. The export is
+/// held for as long as the storage lives, or until the storage holds another
+/// object, which prevents the object from being resized or reallocated while
+/// its data is in use, including without the GIL.
+///
+/// The export is a memoryview of the object, paired with the object itself so
+/// that a new object cannot be mistaken for it.
+///
+/// @pre The GIL is locked.
+const Py_buffer& heldBufferOf(void* storage, PyObject* obj)
+{
+  const auto references = elementReferencesOf(storage, 1);
+  const auto exportRef = references->at(
+    bufferExportSlot,
+    [&](AnyReference ref) { return PyTuple_GET_ITEM(pyObjectOf(ref), 0) == obj; },
+    [&] {
+      const auto view = ::py::reinterpret_steal<::py::object>(PyMemoryView_FromObject(obj));
+      if (!view)
+        throw ::py::error_already_set();
+      return AnyValue::from(::py::object(::py::make_tuple(::py::handle(obj), view))).release();
+    });
+  return *PyMemoryView_GET_BUFFER(PyTuple_GET_ITEM(pyObjectOf(exportRef), 1));
+}
+
+/// Borrows the data of an object that supports the buffer protocol as a
+/// string. The export of the buffer is kept until the managed string is
+/// deleted, which prevents the object from being resized in the meantime.
+///
+/// @pre The GIL is locked.
+StringTypeInterface::ManagedRawString borrowBuffer(const ::py::object& obj)
+{
+  auto view = std::make_unique<Py_buffer>();
+  if (PyObject_GetBuffer(obj.ptr(), view.get(), PyBUF_SIMPLE) != 0)
+    throw ::py::error_already_set();
+
+  const StringTypeInterface::RawString data(static_cast<char*>(view->buf),
+                                            static_cast<size_t>(view->len));
+  std::shared_ptr<Py_buffer> sharedView(view.release(), [](Py_buffer* view) {
+    try
+    {
+      GILAcquire lock;
+      PyBuffer_Release(view);
+    }
+    catch (const InterpreterFinalizingException&)
+    {
+      // Nothing, the interpreter is finalizing and the exporter with it.
+    }
+    delete view;
+  });
+  return { data, [sharedView](const StringTypeInterface::RawString&) mutable {
+             sharedView.reset();
+           } };
+}
+
+/// Tracks the lifetime of the Python objects that values are associated to,
+/// so that the disowned references of their context, which is the object
+/// itself, are destroyed with them.
+///
+/// Each object has a single weak reference, whatever the number of
+/// conversions of the object, and all the weak references share the same
+/// callback, which finds their object in the tracker.
+///
+/// The tracker is protected by the GIL, with which the callback is called.
+class LifetimeTracker
+{
+public:
+  /// Tracks the object, unless it already is.
+  ///
+  /// @pre The GIL is locked.
+  void track(PyObject* obj)
   {
-    GILAcquire lock;
-    result = unwrapValue(pointee);
+    if (_weakrefs.count(obj))
+      return;
+
+    auto* const weakref = PyWeakref_NewRef(obj, callback().ptr());
+    if (!weakref)
+      throw ::py::error_already_set();
+    _weakrefs.emplace(obj, weakref);
+    _objects.emplace(weakref, obj);
   }
 
-  void visitRaw(AnyReference value)
+private:
+  void onDestroyed(PyObject* weakref)
   {
-    /* TODO: zerocopy, sub-buffers... */
-    const auto dataWithSize = value.asRaw();
+    const auto it = _objects.find(weakref);
+    if (it == _objects.end())
+      return;
 
-    GILAcquire lock;
-    result = ::py::reinterpret_steal<::py::object>(
-      PyByteArray_FromStringAndSize(dataWithSize.first, dataWithSize.second));
-  }
+    const auto obj = it->second;
+    _objects.erase(it);
+    _weakrefs.erase(obj);
 
-  void visitIterator(AnyReference v)
-  {
-    visitUnknown(v);
+    // The weak reference is released in its own callback, as nothing else
+    // keeps it alive once it is not tracked anymore.
+    destroyDisownedReferences(obj);
+    Py_DECREF(weakref);
   }
 
-  void visitOptional(AnyReference v)
+  /// The callback of the weak references. It is never destroyed, as it cannot
+  /// be released once the interpreter is finalized.
+  static const ::py::cpp_function& callback()
   {
-    GILAcquire lock;
-    result = unwrapValue(v.content());
+    static const auto* const cb = new ::py::cpp_function([](::py::handle weakref) {
+      instance<LifetimeTracker>()->onDestroyed(weakref.ptr());
+    });
+    return *cb;
   }
 
-  ::py::object& result;
+  std::unordered_map<PyObject*, PyObject*> _weakrefs;
+  std::unordered_map<PyObject*, PyObject*> _objects;
 };
 
-/// Singleton for a default constructible type.
-template<typename T>
-T* instance()
+/// Slot of the context of a Python object at which the value associated to the
+/// object is stored.
+constexpr std::uintptr_t associatedValueSlot = std::numeric_limits<std::uintptr_t>::max() - 1;
+
+/// Associates a value to a Python object, so that it shares its lifetime.
+///
+/// The value is made by a function only if no value is associated to the
+/// object yet. Otherwise, the value associated by a previous conversion of the
+/// object is reused: it is never replaced, as that conversion may still be
+/// using it, and it lives until the object is destroyed.
+///
+/// Function<T ()> F
+///
+/// @pre The GIL is locked.
+template<typename F>
+AnyReference associateValueToObj(::py::object& obj, F&& makeValue)
 {
-  static T instance;
-  return &instance;
+  // The context of the value is the Python object itself rather than any of
+  // the pybind objects that refer to it, so that all the conversions of the
+  // object find the same value.
+  auto* const context = obj.ptr();
+  instance<LifetimeTracker>()->track(context);
+  return storeDisownedReferenceOnceAt(context, associatedValueSlot, [&] {
+    return AnyValue::from(makeValue()).release();
+  });
 }
 
-/// Singleton for a non-default constructible type.
-template<typename T, typename... Args>
-T* instance(Args&&... args)
+} // namespace
+
+namespace detail
 {
-  static boost::synchronized_value<std::map<std::tuple<ka::Decay<Args>...>, T>>
-    instances;
 
-  auto syncInstances = instances.synchronize();
-  auto it = syncInstances->find(std::forward_as_tuple(args...));
-  if (it == syncInstances->end())
+ElementReferences::~ElementReferences()
+{
+  for (auto& slotRef : _slots)
   {
-    std::tie(it, std::ignore) =
-      syncInstances->emplace(std::piecewise_construct,
-                             std::forward_as_tuple(args...),
-                             std::forward_as_tuple(args...));
+    if (slotRef.second.isValid())
+      slotRef.second.destroy();
   }
-  return &it->second;
+  for (auto ref : _replaced)
+    ref.destroy();
 }
 
-/// A 'disowned' reference would be a reference that is not expected to be automatically destroyed,
-/// meaning we would have to manually call destroy on it. Such a storage enables us to associate
-/// such references to a type-erased value so that we can later retrieve them and destroy them
-/// manually.
-using DisownedReferencesStorage =
-  boost::synchronized_value<std::map<void*, std::vector<AnyReference>>>;
-
-void storeDisownedReference(void* context, AnyReference ref) noexcept
+std::size_t ElementReferences::replacedCount() const
 {
-  auto* storage = instance<DisownedReferencesStorage>();
-  auto syncStorage = storage->synchronize();
-  (*syncStorage)[context].push_back(ref);
+  std::scoped_lock<std::mutex> lock(_mutex);
+  return _replaced.size();
 }
 
-std::vector<AnyReference> unstoreDisownedReferences(void* context) noexcept
+std::shared_ptr<ElementReferences>
+DisownedReferencesStorage::elementReferences(void* context, std::size_t containerSize)
 {
-  auto* storage = instance<DisownedReferencesStorage>();
-  auto syncStorage = storage->synchronize();
-  auto it = syncStorage->find(context);
-  if (it == syncStorage->end())
-    return {};
-
-  std::vector<AnyReference> res;
-  swap(it->second, res);
-  syncStorage->erase(it);
-  return res;
+  // The previous references are released after the lock, as destroying them
+  // may destroy the references of nested containers.
+  std::shared_ptr<ElementReferences> previous;
+  auto& shard = shardOf(context);
+  std::scoped_lock<std::mutex> lock(shard.mutex);
+  auto& elements = shard.references[context].elements;
+  if (elements
+      && elements->replacedCount() > std::max(2 * containerSize, minReplacedElementCount))
+    previous = std::exchange(elements, nullptr);
+  if (!elements)
+    elements = std::make_shared<ElementReferences>();
+  return elements;
 }
 
-std::size_t destroyDisownedReferences(void* context) noexcept
+AnyReference DisownedReferencesStorage::storedAt(void* context, std::uintptr_t slot)
 {
-  const auto refs = unstoreDisownedReferences(context);
-  for (auto ref : refs)
-    ref.destroy();
-  return refs.size();
+  auto& shard = shardOf(context);
+  std::scoped_lock<std::mutex> lock(shard.mutex);
+  const auto refsIt = shard.references.find(context);
+  if (refsIt == shard.references.end())
+    return AnyReference();
+  const auto slotIt = refsIt->second.slots.find(slot);
+  if (slotIt == refsIt->second.slots.end())
+    return AnyReference();
+  return slotIt->second;
 }
 
-/// Associates a value to a Python object, so that it shares its lifetime.
-template<typename T>
-AnyReference associateValueToObj(::py::object& obj, T value)
+DisownedReferencesStorage::References DisownedReferencesStorage::unstore(void* context)
 {
-  const auto res = AnyValue::from(std::move(value)).release();
-  auto pybindObjPtr = &obj;
-  storeDisownedReference(pybindObjPtr, res);
+  auto& shard = shardOf(context);
+  std::scoped_lock<std::mutex> lock(shard.mutex);
+  auto it = shard.references.find(context);
+  if (it == shard.references.end())
+    return {};
 
-  // Create a weak reference to the target Python object that will track its lifetime and execute a
-  // callback once it is destroyed.
-  //
-  // The callback ensures that all the references associated to the target object are destroyed, so
-  // that we can leak them here and still ensure that they will be properly destroyed once needed.
-  //
-  // The callback also takes a handle to the weakref Python object itself. We need to make sure that
-  // this weakref object lives as long as the target Python object so that the callback stays
-  // attached to the lifetime of the target object. To do that, we leak the weakref Python object
-  // by releasing it, and we manually decrement the reference count in the callback.
-  auto weakref = ::py::weakref(obj, ::py::cpp_function([=](::py::handle weakref) {
-    destroyDisownedReferences(pybindObjPtr);
-    weakref.dec_ref();
-  }));
-  weakref.release();
+  auto res = std::move(it->second);
+  shard.references.erase(it);
   return res;
 }
 
-} // namespace
+DisownedReferencesStorage::Shard& DisownedReferencesStorage::shardOf(void* context)
+{
+  // Contexts are mostly addresses of heap allocated values, whose lowest bits
+  // are always zero because of alignment, so they are ignored.
+  const auto address = reinterpret_cast<std::uintptr_t>(context);
+  return _shards[(address >> 4) % shardCount];
+}
+
+} // namespace detail
 
 ::py::object unwrapValue(AnyReference val)
 {
   GILAcquire lock;
+  if (columnarConversionEnabled())
+  {
+    if (auto columns = tryStructListToColumns(val))
+      return *columns;
+  }
+
+  if (numpyArrayConversionEnabled())
+  {
+    if (auto array = tryNumericListToNumpyArray(val))
+      return *array;
+  }
+
+  if (lazyContainerViewsEnabled())
+  {
+    if (auto view = tryContainerToView(val))
+      return *view;
+  }
+
+  if (auto list = tryHomogeneousListToPyList(val))
+    return *list;
+
+  // Maps are converted here rather than by `ValueToPyObject::visitMap`, as
+  // their size is not known from their iterators.
+  if (val.kind() == TypeKind_Map)
+    return mapToPyDict(val);
+
   ::py::object result;
   ValueToPyObject tpo(result);
   typeDispatch(tpo, val);
   return result;
 }
 
+::py::object unwrapValue(AnyValue&& val)
+{
+  GILAcquire lock;
+  if (!lazyContainerViewsEnabled())
+    return unwrapValue(val.asReference());
+
+  auto root = std::make_shared<AnyValue>();
+  root->swap(val);
+  ContainerViewsRootScope scope(root);
+  return unwrapValue(root->asReference());
+}
+
+bool numpyArrayConversionEnabled()
+{
+  if (numpyArrayConversionEnabledInThread)
+    return *numpyArrayConversionEnabledInThread;
+  return numpyArrayConversionGloballyEnabled.load();
+}
+
+void setNumpyArrayConversionEnabled(bool enabled)
+{
+  // Fail early if numpy is not available.
+  if (enabled)
+    ::py::module::import("numpy");
+  numpyArrayConversionGloballyEnabled.store(enabled);
+}
+
+NumpyArrayConversionScope::NumpyArrayConversionScope(bool enabled)
+  : _previous(numpyArrayConversionEnabledInThread)
+{
+  if (enabled)
+    ::py::module::import("numpy");
+  numpyArrayConversionEnabledInThread = enabled;
+}
+
+NumpyArrayConversionScope::~NumpyArrayConversionScope()
+{
+  numpyArrayConversionEnabledInThread = _previous;
+}
+
+bool columnarConversionEnabled()
+{
+  if (columnarConversionEnabledInThread)
+    return *columnarConversionEnabledInThread;
+  return columnarConversionGloballyEnabled.load();
+}
+
+void setColumnarConversionEnabled(bool enabled)
+{
+  columnarConversionGloballyEnabled.store(enabled);
+}
+
+ColumnarConversionScope::ColumnarConversionScope(bool enabled)
+  : _previous(columnarConversionEnabledInThread)
+{
+  columnarConversionEnabledInThread = enabled;
+}
+
+ColumnarConversionScope::~ColumnarConversionScope()
+{
+  columnarConversionEnabledInThread = _previous;
+}
+
 namespace types
 {
 
@@ -466,11 +1603,20 @@ template<typename Storage = ::py::str>
 class StrInterface : public ObjectInterfaceBase<Storage, qi::StringTypeInterface>
 {
 public:
+  /// The UTF-8 representation of a string is cached inside the string object
+  /// by Python on its first request. As a string is immutable and is kept
+  /// alive by the storage, this representation is borrowed as is.
   StringTypeInterface::ManagedRawString get(void* storage) override
   {
     GILAcquire lock;
-    ::py::str obj = this->asObject(&storage);
-    return makeManagedString(std::string(obj));
+    const auto& obj = this->asObject(&storage);
+    Py_ssize_t size = 0;
+    const auto data = PyUnicode_AsUTF8AndSize(obj.ptr(), &size);
+    if (!data)
+      throw ::py::error_already_set();
+    const StringTypeInterface::RawString str(const_cast<char*>(data),
+                                             static_cast<size_t>(size));
+    return { str, StringTypeInterface::Deleter() };
   }
 
   void set(void** storage, const char* ptr, size_t sz) override
@@ -478,96 +1624,451 @@ public:
     GILAcquire lock;
      this->asObject(storage) = ::py::str(ptr, sz);
   }
-};
+};
+
+template<typename Storage = ::py::bytes>
+class StringBufferInterface : public ObjectInterfaceBase<Storage,
+                                                         qi::StringTypeInterface>
+{
+public:
+  StringTypeInterface::ManagedRawString get(void* storage) override
+  {
+    GILAcquire lock;
+    const auto& obj = this->asObject(&storage);
+
+    // A `bytes` object is immutable and is kept alive by the storage, its data
+    // can be borrowed as is.
+    if (PyBytes_Check(obj.ptr()))
+    {
+      const StringTypeInterface::RawString data(
+        PyBytes_AS_STRING(obj.ptr()), static_cast<size_t>(PyBytes_GET_SIZE(obj.ptr())));
+      return { data, StringTypeInterface::Deleter() };
+    }
+    return borrowBuffer(obj);
+  }
+
+  void set(void** storage, const char* ptr, size_t sz) override
+  {
+    GILAcquire lock;
+     this->asObject(storage) = ::py::bytes(ptr, sz);
+  }
+};
+
+template<typename Storage = ::py::object>
+class RawBufferInterface : public ObjectInterfaceBase<Storage, qi::RawTypeInterface>
+{
+public:
+  /// The data is borrowed from the object, whose buffer stays exported for as
+  /// long as the storage lives (see `heldBufferOf`).
+  std::pair<char*, size_t> get(void* storage) override
+  {
+    GILAcquire lock;
+    const auto& obj = this->asObject(&storage);
+    const auto& view = heldBufferOf(storage, obj.ptr());
+    return { static_cast<char*>(view.buf), static_cast<size_t>(view.len) };
+  }
+
+  void set(void** storage, const char* ptr, size_t sz) override
+  {
+    GILAcquire lock;
+    this->asObject(storage) = ::py::memoryview(::py::bytes(ptr, sz));
+  }
+};
+
+/// Interface of a list of values of an arithmetic type, whose data is the
+/// contiguous buffer that a Python object exports.
+///
+/// Elements are read directly from the data of the buffer, which is borrowed
+/// from the object. As for `RawBufferInterface`, the buffer stays exported for
+/// as long as the storage lives (see `heldBufferOf`), so that the data that the
+/// iterators read is not reallocated in the meantime.
+template<typename T, typename Storage = ::py::object>
+class NumericBufferListInterface : public ObjectInterfaceBase<Storage, qi::ListTypeInterface>
+{
+public:
+  struct Iterator
+  {
+    const char* data;
+    std::size_t index;
+
+    // Iterators are compared by index only: the iterators of a storage all
+    // read the same held export, whose data does not change.
+    friend bool operator==(const Iterator& a, const Iterator& b)
+    {
+      return a.index == b.index;
+    }
+
+    friend bool operator<(const Iterator& a, const Iterator& b)
+    {
+      return a.index < b.index;
+    }
+  };
+
+  class IteratorInterface : public qi::IteratorTypeInterface
+  {
+  public:
+    AnyReference dereference(void* storage) override
+    {
+      const auto& iter = asIter(&storage);
+      auto* const elementPtr = const_cast<char*>(iter.data) + iter.index * sizeof(T);
+      auto* const type = typeOf<T>();
+      return AnyReference(type, type->initializeStorage(elementPtr));
+    }
+
+    void next(void** storage) override { ++asIter(storage).index; }
+    bool equals(void* s1, void* s2) override { return asIter(&s1) == asIter(&s2); }
+
+    using DefaultImpl = DefaultTypeImplMethods<Iterator, TypeByPointerPOD<Iterator>>;
+
+    void* initializeStorage(void* ptr = nullptr) override { return DefaultImpl::initializeStorage(ptr); }
+    void* clone(void* storage) override { return DefaultImpl::clone(storage); }
+    void destroy(void* storage) override { return DefaultImpl::destroy(storage); }
+    const TypeInfo& info() override { return DefaultImpl::info(); }
+    void* ptrFromStorage(void** s) override { return DefaultImpl::ptrFromStorage(s); }
+    bool less(void* a, void* b) override { return DefaultImpl::less(a, b); }
+
+    Iterator* asIterPtr(void** storage) { return static_cast<Iterator*>(ptrFromStorage(storage)); }
+    Iterator& asIter(void** storage) { return *asIterPtr(storage); }
+  };
+
+  TypeInterface* elementType() override
+  {
+    return typeOf<T>();
+  }
+
+  size_t size(void* storage) override
+  {
+    return dataOf(storage).second / sizeof(T);
+  }
+
+  void pushBack(void** /*storage*/, void* /*valueStorage*/) override
+  {
+    throw std::runtime_error("cannot append an element to a buffer");
+  }
+
+  AnyIterator begin(void* storage) override
+  {
+    return makeIterator(Iterator{ dataOf(storage).first, 0 });
+  }
+
+  AnyIterator end(void* storage) override
+  {
+    const auto data = dataOf(storage);
+    return makeIterator(Iterator{ data.first, data.second / sizeof(T) });
+  }
+
+private:
+  static AnyIterator makeIterator(Iterator iter)
+  {
+    return AnyValue(AnyReference(instance<IteratorInterface>(), new Iterator(iter)),
+                    // Do not copy, but free the value, so basically the AnyValue
+                    // takes ownership of the object.
+                    false, true);
+  }
+
+  std::pair<const char*, std::size_t> dataOf(void* storage)
+  {
+    GILAcquire lock;
+    const auto& obj = this->asObject(&storage);
+    const auto& view = heldBufferOf(storage, obj.ptr());
+    return { static_cast<const char*>(view.buf), static_cast<std::size_t>(view.len) };
+  }
+};
+
+/// Interface of the copy of the items of a structured iterable (see
+/// `StructuredIterableInterface`), which holds the iterable and its items. The
+/// items are the storages of the members of the iterable, and the references
+/// associated to them, such as the ones to the elements of nested containers,
+/// are destroyed with the copy.
+class ItemsSnapshotInterface : public qi::TypeInterface
+{
+public:
+  struct Snapshot
+  {
+    ::py::object source;
+    std::vector<::py::object> items;
+  };
+
+  using DefaultImpl = DefaultTypeImplMethods<Snapshot>;
+
+  const TypeInfo& info() override { return DefaultImpl::info(); }
+  void* initializeStorage(void* ptr = nullptr) override { return DefaultImpl::initializeStorage(ptr); }
+  void* ptrFromStorage(void** s) override { return DefaultImpl::ptrFromStorage(s); }
+  bool less(void* a, void* b) override { return a < b; }
+
+  void* clone(void* storage) override
+  {
+    GILAcquire lock;
+    return DefaultImpl::clone(storage);
+  }
+
+  void destroy(void* storage) override
+  {
+    GILAcquire lock;
+    // The copy is private to its reference, nothing else refers to its items.
+    for (auto& item : asSnapshot(&storage).items)
+      destroyDisownedReferences(&item);
+    DefaultImpl::destroy(storage);
+  }
+
+  /// @pre `ref` is a reference of this type.
+  static Snapshot& snapshotOf(AnyReference ref)
+  {
+    auto storage = ref.rawValue();
+    return instance<ItemsSnapshotInterface>()->asSnapshot(&storage);
+  }
+
+  /// Copies the items of a structured iterable.
+  ///
+  /// @pre The GIL is locked.
+  static AnyReference make(PyObject* iterable)
+  {
+    auto snapshot = std::make_unique<Snapshot>();
+    snapshot->source = ::py::reinterpret_borrow<::py::object>(iterable);
+    if (PyTuple_Check(iterable))
+    {
+      const auto size = PyTuple_GET_SIZE(iterable);
+      snapshot->items.reserve(static_cast<std::size_t>(size));
+      for (Py_ssize_t i = 0; i < size; ++i)
+        snapshot->items.push_back(
+          ::py::reinterpret_borrow<::py::object>(PyTuple_GET_ITEM(iterable, i)));
+    }
+    else
+    {
+      for (const auto item : ::py::handle(iterable))
+        snapshot->items.push_back(::py::reinterpret_borrow<::py::object>(item));
+    }
+    return AnyReference(instance<ItemsSnapshotInterface>(), snapshot.release());
+  }
+
+private:
+  Snapshot& asSnapshot(void** storage) { return *static_cast<Snapshot*>(ptrFromStorage(storage)); }
+};
+
+template<typename Storage>
+class StructuredIterableInterface
+  : public ObjectInterfaceBase<Storage, qi::StructTypeInterface>
+{
+public:
+  StructuredIterableInterface(std::size_t size)
+    : _size(size)
+  {}
+
+  std::vector<TypeInterface*> memberTypes() override
+  {
+    return std::vector<TypeInterface*>(_size, typeOf<::py::object>());
+  }
+
+  std::vector<void*> get(void* storage) override
+  {
+    GILAcquire lock;
+    auto* const items = itemsOf(storage, true);
+
+    std::vector<void*> res;
+    res.reserve(_size);
+    for (std::size_t i = 0; i < _size; ++i)
+      res.push_back(&items[i]);
+    return res;
+  }
+
+  void* get(void* storage, unsigned int index) override
+  {
+    QI_ASSERT_TRUE(index < _size);
+
+    GILAcquire lock;
+    return &itemsOf(storage, false)[index];
+  }
+
+  void set(void** /*storage*/, const std::vector<void*>&) override
+  {
+    throw std::runtime_error("set a python structured iterable object is unimplemented");
+  }
 
-template<typename Storage = ::py::bytes, typename BufferType = ::py::bytes>
-class StringBufferInterface : public ObjectInterfaceBase<Storage,
-                                                         qi::StringTypeInterface>
-{
-public:
-  StringTypeInterface::ManagedRawString get(void* storage) override
+  void set(void** /*storage*/, unsigned int /*index*/, void* /*valStorage*/) override
   {
-    GILAcquire lock;
-    ::py::buffer obj = this->asObject(&storage);
-    const auto info = obj.request();
-    QI_ASSERT_TRUE(info.ndim == 1);
-    QI_ASSERT_TRUE(info.itemsize == sizeof(char));
-    return makeManagedString(std::string(static_cast<char*>(info.ptr), info.size));
+    throw std::runtime_error("set a python structured iterable object is unimplemented");
   }
 
-  void set(void** storage, const char* ptr, size_t sz) override
+private:
+  // Slot of the references where the copy of the items is stored.
+  static constexpr auto snapshotSlot = std::numeric_limits<std::uintptr_t>::max();
+
+  // Returns the items of the iterable, as an array of objects. The storage of
+  // each member is the address of an item in this array.
+  //
+  // The items are copied, so that the addresses of the members, and the
+  // references associated to them, are not shared with the other storages of
+  // the same iterable. The copy is stored with the references to the elements
+  // of the iterable, and holds the iterable, so that a new object cannot be
+  // mistaken for it. Tuples and frozensets cannot change, the copy of their
+  // items is reused as long as the storage holds the same object. Sets are
+  // copied again by each traversal of all their members, and accesses to a
+  // single member read the set as it was at its last traversal. The previous
+  // copies are kept with the references, as readers may still be using them.
+  //
+  // @throws `std::runtime_error` if the size of the iterable changed.
+  // @pre The GIL is locked.
+  ::py::object* itemsOf(void* storage, bool traversal)
   {
-    GILAcquire lock;
-     this->asObject(storage) = ::py::bytes(ptr, sz);
+    const auto obj = this->asObject(&storage).ptr();
+    const auto isImmutable = PyTuple_Check(obj) || PyFrozenSet_Check(obj);
+    const auto references = elementReferencesOf(storage, _size);
+    auto& snapshot = ItemsSnapshotInterface::snapshotOf(references->at(
+      snapshotSlot,
+      [&](AnyReference ref) {
+        return ref.type() == instance<ItemsSnapshotInterface>()
+            && ItemsSnapshotInterface::snapshotOf(ref).source.ptr() == obj
+            && (isImmutable || !traversal);
+      },
+      [&] { return ItemsSnapshotInterface::make(obj); }));
+
+    if (snapshot.items.size() != _size)
+      throw std::runtime_error("the size of a python structured iterable object changed");
+    return snapshot.items.data();
   }
+
+  std::size_t _size;
 };
 
-template<typename Storage>
-class StructuredIterableInterface
+/// Interface of the instances of a class registered as a structure type (see
+/// `registerStructClass`). Members are the fields of the instances, which are
+/// read by index for NamedTuple instances and by attribute for dataclass
+/// instances.
+template<typename Storage = ::py::object>
+class StructClassInterface
   : public ObjectInterfaceBase<Storage, qi::StructTypeInterface>
 {
 public:
-  StructuredIterableInterface(std::size_t size)
-    : _size(size)
+  StructClassInterface(std::string name,
+                       std::vector<std::string> fieldNames,
+                       std::vector<TypeInterface*> memberTypes,
+                       bool isTuple)
+    : _name(std::move(name))
+    , _fieldNames(std::move(fieldNames))
+    , _memberTypes(std::move(memberTypes))
+    , _isTuple(isTuple)
   {}
 
   std::vector<TypeInterface*> memberTypes() override
   {
-    return std::vector<TypeInterface*>(_size, typeOf<::py::object>());
+    return _memberTypes;
   }
 
-  std::vector<void*> get(void* storage) override
+  std::vector<std::string> elementsName() override
   {
-    GILAcquire lock;
-    const auto& obj = this->asObject(&storage);
+    return _fieldNames;
+  }
 
+  std::string className() override
+  {
+    return _name;
+  }
+
+  std::vector<void*> get(void* storage) override
+  {
     std::vector<void*> res;
-    res.reserve(_size);
-    for (const ::py::handle itemHandle : obj)
-    {
-      const auto item = ::py::reinterpret_borrow<::py::object>(itemHandle);
-      const auto itemRef = AnyValue::from(item).release();
-      storeDisownedReference(storage, itemRef);
-      res.push_back(itemRef.rawValue());
-    }
+    res.reserve(_fieldNames.size());
+    for (unsigned int i = 0; i < _fieldNames.size(); ++i)
+      res.push_back(get(storage, i));
     return res;
   }
 
   void* get(void* storage, unsigned int index) override
   {
-    QI_ASSERT_TRUE(index < _size);
+    QI_ASSERT_TRUE(index < _fieldNames.size());
 
     GILAcquire lock;
     const auto& obj = this->asObject(&storage);
-    // AppleClang 8 wrongly requires a ForwardIterator on `std::next`, which
-    // `pybind11::iterator` is not. We use advance instead.
-    auto it = obj.begin();
-    std::advance(it, index);
-    const auto item = ::py::reinterpret_borrow<::py::object>(*it);
-    const auto itemRef = AnyValue::from(item).release();
-    storeDisownedReference(storage, itemRef);
-    return itemRef.rawValue();
+    ::py::object field;
+    if (_isTuple)
+    {
+      if (index >= static_cast<std::size_t>(PyTuple_GET_SIZE(obj.ptr())))
+        throw std::runtime_error("the size of a python structure object changed");
+      field = ::py::reinterpret_borrow<::py::object>(PyTuple_GET_ITEM(obj.ptr(), index));
+    }
+    else
+    {
+      const auto& fieldName = _fieldNames[index];
+      field = obj.attr(internedKeys().get(fieldName.data(), fieldName.size()));
+    }
+    const auto references = elementReferencesOf(storage, _fieldNames.size());
+    return elementReference(*references, index, field.ptr(), _memberTypes[index]).rawValue();
   }
 
   void set(void** /*storage*/, const std::vector<void*>&) override
   {
-    throw std::runtime_error("set a python structured iterable object is unimplemented");
+    throw std::runtime_error("set a python structure object is unimplemented");
   }
 
   void set(void** /*storage*/, unsigned int /*index*/, void* /*valStorage*/) override
   {
-    throw std::runtime_error("set a python structured iterable object is unimplemented");
+    throw std::runtime_error("set a python structure object is unimplemented");
   }
 
 private:
-  std::size_t _size;
+  std::string _name;
+  std::vector<std::string> _fieldNames;
+  std::vector<TypeInterface*> _memberTypes;
+  bool _isTuple;
 };
 
-template<typename Storage = ::py::list, typename ListType = ::py::list>
+/// Kind of the objects of an interface of a primitive type, `None` for the
+/// other interfaces.
+template<typename Interface>
+constexpr PrimitiveKind primitiveKindOfInterface = PrimitiveKind::None;
+template<>
+constexpr PrimitiveKind primitiveKindOfInterface<BoolInterface<::py::object>> = PrimitiveKind::Bool;
+template<>
+constexpr PrimitiveKind primitiveKindOfInterface<IntInterface<::py::object>> = PrimitiveKind::Int;
+template<>
+constexpr PrimitiveKind primitiveKindOfInterface<FloatInterface<::py::object>> = PrimitiveKind::Float;
+template<>
+constexpr PrimitiveKind primitiveKindOfInterface<StrInterface<::py::object>> = PrimitiveKind::Str;
+
+/// Returns the interface of an element of a container whose elements were all
+/// of the type of `ElementInterface` when it was converted. The container may
+/// have changed since then, so an element of another type is exposed with the
+/// dynamic interface instead, which any object supports.
+///
+/// @pre The GIL is locked.
+template<typename ElementInterface>
+TypeInterface* elementInterfaceOf(PyObject* element)
+{
+  constexpr auto kind = primitiveKindOfInterface<ElementInterface>;
+  if (kind == PrimitiveKind::None || primitiveKindOf(element) == kind)
+    return instance<ElementInterface>();
+  return instance<DynamicInterface<::py::object>>();
+}
+
+/// Interface of a list whose elements are exposed with the interface
+/// `ElementInterface`, which is the dynamic interface unless all the elements
+/// are known to be of the same primitive type.
+template<typename Storage = ::py::list, typename ListType = ::py::list,
+         typename ElementInterface = DynamicInterface<::py::object>>
 class ListInterface : public ObjectInterfaceBase<Storage, qi::ListTypeInterface>
 {
 public:
-  using Iterator = std::pair<void* /*list storage*/, unsigned int /*element*/>;
+  struct Iterator
+  {
+    void* listStorage;
+    unsigned int index;
+    /// References to the elements that the traversal reads, which live at
+    /// least as long as the iterators of the traversal. Null for end iterators.
+    std::shared_ptr<detail::ElementReferences> references;
+    /// Copy of a sequence that is not a list, made at the beginning of the
+    /// traversal and kept alive by `references`, or null.
+    PyObject* snapshot;
+
+    friend bool operator==(const Iterator& a, const Iterator& b)
+    {
+      return a.listStorage == b.listStorage && a.index == b.index;
+    }
+
+    friend bool operator<(const Iterator& a, const Iterator& b)
+    {
+      return std::tie(a.listStorage, a.index) < std::tie(b.listStorage, b.index);
+    }
+  };
 
   class IteratorInterface : public qi::IteratorTypeInterface
   {
@@ -575,25 +2076,27 @@ public:
     AnyReference dereference(void* storage) override
     {
       const auto& iter = asIter(&storage);
-      auto* const listType = instance<ListInterface>();
-      auto* listStorage = iter.first;
-      const auto index = iter.second;
+      const auto index = iter.index;
 
       GILAcquire lock;
-      ListType list = listType->asObject(&listStorage);
-      const ::py::object element = list[index];
-
-      auto ref = AnyReference::from(element).clone();
-      // Store the disowned reference with the list as a context instead of the
-      // iterator because the reference might outlive the iterator.
-      storeDisownedReference(listStorage, ref);
-      return ref;
+      auto* listStorage = iter.listStorage;
+      const auto list =
+        iter.snapshot ? iter.snapshot
+                      : instance<ListInterface>()->asObject(&listStorage).ptr();
+      if (!iter.references || index >= static_cast<std::size_t>(PyList_GET_SIZE(list)))
+        throw std::out_of_range("cannot dereference an iterator past the end of a list");
+
+      // The reference is stored with the references of the traversal instead
+      // of the iterator because it might outlive the iterator.
+      auto* const element = PyList_GET_ITEM(list, index);
+      return elementReference(*iter.references, index, element,
+                              elementInterfaceOf<ElementInterface>(element));
     }
 
-    void next(void** storage) override { ++asIter(storage).second; }
+    void next(void** storage) override { ++asIter(storage).index; }
     bool equals(void* s1, void* s2) override { return asIter(&s1) == asIter(&s2); }
 
-    using DefaultImpl = DefaultTypeImplMethods<Iterator, TypeByPointerPOD<Iterator>>;
+    using DefaultImpl = DefaultTypeImplMethods<Iterator>;
 
     void* initializeStorage(void* ptr = nullptr) override { return DefaultImpl::initializeStorage(ptr); }
     void* clone(void* storage) override { return DefaultImpl::clone(storage); }
@@ -606,9 +2109,9 @@ public:
     Iterator& asIter(void** storage) { return *asIterPtr(storage); }
   };
 
-  DynamicInterface<::py::object>* elementType() override
+  ElementInterface* elementType() override
   {
-    return instance<DynamicInterface<::py::object>>();
+    return instance<ElementInterface>();
   }
 
   size_t size(void* storage) override
@@ -633,7 +2136,19 @@ public:
 
   AnyIterator begin(void* storage) override
   {
-    return AnyValue(AnyReference(instance<IteratorInterface>(), new Iterator(storage, 0)),
+    GILAcquire lock;
+    const auto& obj = this->asObject(&storage);
+    const auto length = PyObject_Length(obj.ptr());
+    if (length < 0)
+      throw ::py::error_already_set();
+
+    auto references = elementReferencesOf(storage, static_cast<std::size_t>(length));
+    PyObject* snapshot = nullptr;
+    if (!PyList_Check(obj.ptr()))
+      snapshot = storeSnapshot(obj, *references);
+
+    return AnyValue(AnyReference(instance<IteratorInterface>(),
+                                 new Iterator{ storage, 0, std::move(references), snapshot }),
                     // Do not copy, but free the value, so basically the AnyValue
                     // takes ownership of the object.
                     false, true);
@@ -642,18 +2157,83 @@ public:
   AnyIterator end(void* storage) override
   {
     return AnyValue(AnyReference(instance<IteratorInterface>(),
-                                 new Iterator(storage, size(storage))),
+                                 new Iterator{ storage, static_cast<unsigned int>(size(storage)),
+                                               nullptr, nullptr }),
                     // Do not copy, but free the value, so basically the AnyValue
                     // takes ownership of the object.
                     false, true);
   }
+
+private:
+  // Slot of the references where the copy of a sequence that is not a list is
+  // stored. Slots of elements are their index.
+  static constexpr auto snapshotSlot = std::numeric_limits<std::uintptr_t>::max();
+
+  // Copies a sequence that is not a list (i.e. a dictionary view) in a list
+  // stored with the references of the traversal, and returns it. The copy of a
+  // previous traversal is reused if it still holds the same objects, so that
+  // the references to its elements can be reused too. Objects are compared by
+  // identity so that no Python code runs while the references are locked.
+  //
+  // @pre The GIL is locked.
+  static PyObject* storeSnapshot(const Storage& obj, detail::ElementReferences& references)
+  {
+    const auto snapshot = ::py::reinterpret_steal<::py::object>(PySequence_List(obj.ptr()));
+    if (!snapshot)
+      throw ::py::error_already_set();
+
+    const auto holdsSameObjects = [&](AnyReference previousRef) {
+      const auto previous = pyObjectOf(previousRef);
+      const auto size = PyList_GET_SIZE(snapshot.ptr());
+      if (PyList_GET_SIZE(previous) != size)
+        return false;
+      for (Py_ssize_t i = 0; i < size; ++i)
+      {
+        if (PyList_GET_ITEM(previous, i) != PyList_GET_ITEM(snapshot.ptr(), i))
+          return false;
+      }
+      return true;
+    };
+    return pyObjectOf(references.at(snapshotSlot, holdsSameObjects,
+                                    [&] { return AnyValue::from(snapshot).release(); }));
+  }
 };
 
-template<typename Storage>
+/// Interface of a dictionary whose keys and elements are exposed with the
+/// interfaces `KeyInterface` and `ElementInterface`, which are the dynamic
+/// interface unless all the keys, or all the elements, are known to be of the
+/// same primitive type.
+template<typename Storage,
+         typename KeyInterface = DynamicInterface<::py::object>,
+         typename ElementInterface = DynamicInterface<::py::object>>
 class DictInterface: public ObjectInterfaceBase<Storage, qi::MapTypeInterface>
 {
 public:
-  using Iterator = std::pair<void* /*dict storage*/, unsigned int /*element*/>;
+  /// Iterators traverse the dictionary with `PyDict_Next`, so that a complete
+  /// traversal is linear in the size of the dictionary.
+  struct Iterator
+  {
+    void* dictStorage;
+    /// Position of the current element, as expected by `PyDict_Next`.
+    Py_ssize_t position;
+    /// Index of the current element in the order of iteration.
+    std::size_t index;
+    /// Size of the dictionary when the iteration began.
+    std::size_t size;
+    /// References to the pairs that the traversal reads, which live at least
+    /// as long as the iterators of the traversal. Null for end iterators.
+    std::shared_ptr<detail::ElementReferences> references;
+
+    friend bool operator==(const Iterator& a, const Iterator& b)
+    {
+      return a.dictStorage == b.dictStorage && a.index == b.index;
+    }
+
+    friend bool operator<(const Iterator& a, const Iterator& b)
+    {
+      return std::tie(a.dictStorage, a.index) < std::tie(b.dictStorage, b.index);
+    }
+  };
 
   class IteratorInterface : public qi::IteratorTypeInterface
   {
@@ -661,31 +2241,49 @@ public:
     AnyReference dereference(void* storage) override
     {
       const auto& iter = asIter(&storage);
-      auto* const dictType = instance<DictInterface>();
-      auto* dictStorage = iter.first;
-      const auto index = iter.second;
 
       GILAcquire lock;
-      ::py::dict dict = dictType->asObject(&dictStorage);
-      // AppleClang 8 wrongly requires a ForwardIterator on `std::next`, which
-      // `pybind11::iterator` is not. We use advance instead.
-      auto it = dict.begin();
-      std::advance(it, index);
-      const auto key = ::py::reinterpret_borrow<::py::object>(it->first);
-      const auto element = ::py::reinterpret_borrow<::py::object>(it->second);
-      auto keyRef = AnyReference::from(key);
-      auto elementRef = AnyReference::from(element);
-      auto pairRef = makeGenericTuple({keyRef, elementRef});
-      // Store the disowned reference with the list as a context instead of the
-      // iterator because the reference might outlive the iterator.
-      storeDisownedReference(dictStorage, pairRef);
-      return pairRef;
-    }
-
-    void next(void** storage) override { ++asIter(storage).second; }
+      const auto& dict = dictOf(iter);
+      auto position = iter.position;
+      PyObject* keyPtr = nullptr;
+      PyObject* elementPtr = nullptr;
+      if (!iter.references || !PyDict_Next(dict.ptr(), &position, &keyPtr, &elementPtr))
+        throw std::runtime_error("cannot dereference an iterator past the end of a dictionary");
+
+      // Store the pair with the references of the traversal instead of the
+      // iterator because the reference might outlive the iterator. Each
+      // position has its own slot, so that a pair is only made again if the
+      // dictionary changed.
+      auto* const keyType = elementInterfaceOf<KeyInterface>(keyPtr);
+      auto* const elementType = elementInterfaceOf<ElementInterface>(elementPtr);
+      auto* const pairType = pairTypeOf(keyType, elementType);
+      const auto isPairOfElement = [&](AnyReference pairRef) {
+        return pairRef.type() == pairType
+            && pyObjectOfMember(pairRef, 0) == keyPtr
+            && pyObjectOfMember(pairRef, 1) == elementPtr;
+      };
+      const auto makePair = [&] {
+        auto key = ::py::reinterpret_borrow<::py::object>(keyPtr);
+        auto element = ::py::reinterpret_borrow<::py::object>(elementPtr);
+        return makeGenericTuple({ AnyReference(keyType, &key),
+                                  AnyReference(elementType, &element) });
+      };
+      return iter.references->at(iter.index, isPairOfElement, makePair);
+    }
+
+    void next(void** storage) override
+    {
+      auto& iter = asIter(storage);
+
+      GILAcquire lock;
+      const auto& dict = dictOf(iter);
+      PyDict_Next(dict.ptr(), &iter.position, nullptr, nullptr);
+      ++iter.index;
+    }
+
     bool equals(void* s1, void* s2) override { return asIter(&s1) == asIter(&s2); }
 
-    using DefaultImpl = DefaultTypeImplMethods<Iterator, TypeByPointerPOD<Iterator>>;
+    using DefaultImpl = DefaultTypeImplMethods<Iterator>;
 
     void* initializeStorage(void* ptr = nullptr) override { return DefaultImpl::initializeStorage(ptr); }
     void* clone(void* storage) override { return DefaultImpl::clone(storage); }
@@ -696,16 +2294,51 @@ public:
 
     Iterator* asIterPtr(void** storage) { return static_cast<Iterator*>(ptrFromStorage(storage)); }
     Iterator& asIter(void** storage) { return *asIterPtr(storage); }
+
+  private:
+    // Returns the dictionary the iterator traverses, after checking that its
+    // size did not change since the iteration began, in which case the
+    // position of the iterator is meaningless.
+    //
+    // @pre The GIL is locked.
+    static const Storage& dictOf(const Iterator& iter)
+    {
+      auto* dictStorage = iter.dictStorage;
+      const auto& dict = instance<DictInterface>()->asObject(&dictStorage);
+      if (static_cast<std::size_t>(PyDict_Size(dict.ptr())) != iter.size)
+        throw std::runtime_error("dictionary changed size during iteration");
+      return dict;
+    }
+
+    // Returns the type of the pairs of a key and an element of the given
+    // types, which are either the static interfaces of the dictionary or the
+    // dynamic one.
+    static TypeInterface* pairTypeOf(TypeInterface* keyType, TypeInterface* elementType)
+    {
+      const auto pairType = [](TypeInterface* key, TypeInterface* element) {
+        return makeTupleType(std::vector<TypeInterface*>{ key, element });
+      };
+      auto* const dynamicType = instance<DynamicInterface<::py::object>>();
+      static auto* const staticPairType = pairType(instance<KeyInterface>(), instance<ElementInterface>());
+      static auto* const dynamicKeyPairType = pairType(dynamicType, instance<ElementInterface>());
+      static auto* const dynamicElementPairType = pairType(instance<KeyInterface>(), dynamicType);
+      static auto* const dynamicPairType = pairType(dynamicType, dynamicType);
+      const bool staticKey = keyType == instance<KeyInterface>();
+      const bool staticElement = elementType == instance<ElementInterface>();
+      if (staticKey)
+        return staticElement ? staticPairType : dynamicElementPairType;
+      return staticElement ? dynamicKeyPairType : dynamicPairType;
+    }
   };
 
-  DynamicInterface<::py::object>* elementType() override
+  ElementInterface* elementType() override
   {
-    return instance<DynamicInterface<::py::object>>();
+    return instance<ElementInterface>();
   }
 
-  DynamicInterface<::py::object>* keyType() override
+  KeyInterface* keyType() override
   {
-    return instance<DynamicInterface<::py::object>>();
+    return instance<KeyInterface>();
   }
 
   size_t size(void* storage) override
@@ -717,9 +2350,10 @@ public:
 
   AnyIterator begin(void* storage) override
   {
-    GILAcquire lock;
-    ::py::dict dict = this->asObject(&storage);
-    return AnyValue(AnyReference(instance<IteratorInterface>(), new Iterator(storage, 0)),
+    const auto dictSize = size(storage);
+    return AnyValue(AnyReference(instance<IteratorInterface>(),
+                                 new Iterator{ storage, 0, 0, dictSize,
+                                               elementReferencesOf(storage, dictSize) }),
                     // Do not copy, but free the value, so basically the AnyValue
                     // takes ownership of the object.
                     false, true);
@@ -727,8 +2361,9 @@ public:
 
   AnyIterator end(void* storage) override
   {
+    const auto dictSize = size(storage);
     return AnyValue(AnyReference(instance<IteratorInterface>(),
-                                 new Iterator(storage, size(storage))),
+                                 new Iterator{ storage, 0, dictSize, dictSize, nullptr }),
                     // Do not copy, but free the value, so basically the AnyValue
                     // takes ownership of the object.
                     false, true);
@@ -756,19 +2391,286 @@ public:
     {
       if (!autoInsert)
         return AnyReference();
-      dict[key] = ::py::none();
+      value = ::py::none();
+      dict[key] = value;
     }
 
-    auto ref = AnyReference::from(value).clone();
-    // Store the disowned reference with the list as a context instead of the
-    // iterator because the reference might outlive the iterator.
-    storeDisownedReference(storage, ref);
-    return ref;
+    // Store the reference with the references to the elements of the
+    // dictionary. Its slot is derived from the hash of the key, so that looking
+    // up the same key again reuses it while its value is the same, and the
+    // slots are as many as the keys that are looked up.
+    const auto hash = PyObject_Hash(key.ptr());
+    if (hash == -1)
+      throw ::py::error_already_set();
+    const auto references = elementReferencesOf(*storage, dict.size());
+    return elementReference(*references, lookupSlot(hash), value.ptr(),
+                            elementInterfaceOf<ElementInterface>(value.ptr()));
+  }
+
+private:
+  // Returns the slot of the references to the elements where the value of a
+  // key of a hash is stored. The highest bit of the slot is set, so that it is
+  // never mistaken for the positions that iterators use as slots.
+  static std::uintptr_t lookupSlot(Py_hash_t hash)
+  {
+    constexpr auto highestBit = std::uintptr_t(1) << (std::numeric_limits<std::uintptr_t>::digits - 1);
+    return static_cast<std::uintptr_t>(hash) | highestBit;
   }
 };
 
 } // namespace types
 
+namespace
+{
+
+template<typename T>
+TypeInterface* numericBufferListInterface()
+{
+  return instance<types::NumericBufferListInterface<T>>();
+}
+
+/// Returns the interface of the list of numbers that the object is if it exports
+/// a one-dimensional contiguous buffer of integers of at least 2 bytes or of
+/// floating point numbers in the native byte order, or null otherwise.
+///
+/// Buffers of single bytes are considered raw data rather than numbers.
+///
+/// @pre The GIL is locked.
+TypeInterface* numericBufferListInterface(const ::py::object& obj)
+{
+  if (!PyObject_CheckBuffer(obj.ptr()))
+    return nullptr;
+
+  Py_buffer view;
+  if (PyObject_GetBuffer(obj.ptr(), &view, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) != 0)
+  {
+    PyErr_Clear();
+    return nullptr;
+  }
+  const auto ndim = view.ndim;
+  const auto itemSize = view.itemsize;
+  std::string format = view.format ? view.format : "B";
+  PyBuffer_Release(&view);
+
+  if (ndim != 1)
+    return nullptr;
+
+  // The format is a type code, optionally prefixed by a byte order character.
+  static const bool isLittleEndian = [] {
+    const std::uint16_t one = 1;
+    return *reinterpret_cast<const unsigned char*>(&one) == 1;
+  }();
+  if (!format.empty() && std::strchr("@=<>!", format.front()))
+  {
+    const auto order = format.front();
+    if ((order == '<' && !isLittleEndian) || ((order == '>' || order == '!') && isLittleEndian))
+      return nullptr;
+    format.erase(0, 1);
+  }
+  if (format.size() != 1)
+    return nullptr;
+
+  const auto code = format.front();
+  if (std::strchr("hilqn", code))
+  {
+    switch (itemSize)
+    {
+      case 2: return numericBufferListInterface<std::int16_t>();
+      case 4: return numericBufferListInterface<std::int32_t>();
+      case 8: return numericBufferListInterface<std::int64_t>();
+    }
+  }
+  else if (std::strchr("HILQN", code))
+  {
+    switch (itemSize)
+    {
+      case 2: return numericBufferListInterface<std::uint16_t>();
+      case 4: return numericBufferListInterface<std::uint32_t>();
+      case 8: return numericBufferListInterface<std::uint64_t>();
+    }
+  }
+  else if (code == 'f' && itemSize == sizeof(float))
+    return numericBufferListInterface<float>();
+  else if (code == 'd' && itemSize == sizeof(double))
+    return numericBufferListInterface<double>();
+  return nullptr;
+}
+
+/// Accumulates the kinds of objects to find the kind they have in common.
+class CommonPrimitiveKind
+{
+public:
+  /// Returns false once the objects have no kind in common, which makes
+  /// considering more objects useless.
+  bool add(PyObject* obj)
+  {
+    const auto kind = primitiveKindOf(obj);
+    if (_empty)
+    {
+      _kind = kind;
+      _empty = false;
+    }
+    else if (kind != _kind)
+      _kind = PrimitiveKind::None;
+    return _kind != PrimitiveKind::None;
+  }
+
+  /// Returns the kind all the objects have, or `None` if there are none.
+  PrimitiveKind kind() const { return _kind; }
+
+private:
+  bool _empty = true;
+  PrimitiveKind _kind = PrimitiveKind::None;
+};
+
+/// Invokes a function with the tag of the interface of the objects of a kind,
+/// which is the dynamic interface for objects that have no primitive kind.
+template<typename F>
+TypeInterface* invokeWithInterfaceOf(PrimitiveKind kind, F&& f)
+{
+  switch (kind)
+  {
+    case PrimitiveKind::Bool: return f(TypeTag<types::BoolInterface<::py::object>>{});
+    case PrimitiveKind::Int: return f(TypeTag<types::IntInterface<::py::object>>{});
+    case PrimitiveKind::Float: return f(TypeTag<types::FloatInterface<::py::object>>{});
+    case PrimitiveKind::Str: return f(TypeTag<types::StrInterface<::py::object>>{});
+    default: return f(TypeTag<types::DynamicInterface<::py::object>>{});
+  }
+}
+
+/// Returns the interface of a list, whose element type is the type of its
+/// elements if they are all exactly of the same primitive type, which allows
+/// libqi to serialize them with a static signature (such as `[i]`) instead of
+/// one signature per element. Otherwise, the element type is dynamic.
+///
+/// All the elements are checked, as a single element of another type would
+/// make the conversion of the list fail. This only costs a comparison of
+/// pointers per element. The list may still change after its conversion, in
+/// which case its elements of another type are exposed as dynamic values (see
+/// `types::elementInterfaceOf`).
+///
+/// @pre `PyList_Check(list)`
+/// @pre The GIL is locked.
+TypeInterface* listInterface(PyObject* list)
+{
+  CommonPrimitiveKind elementKind;
+  const auto size = PyList_GET_SIZE(list);
+  for (Py_ssize_t i = 0; i < size; ++i)
+  {
+    if (!elementKind.add(PyList_GET_ITEM(list, i)))
+      break;
+  }
+
+  return invokeWithInterfaceOf(elementKind.kind(), [](auto elementTag) -> TypeInterface* {
+    using ElementInterface = typename decltype(elementTag)::type;
+    return instance<types::ListInterface<::py::object, ::py::list, ElementInterface>>();
+  });
+}
+
+/// Returns the interface of a dictionary, whose key and element types are
+/// inferred as for lists (see `listInterface`).
+///
+/// @pre `PyDict_Check(dict)`
+/// @pre The GIL is locked.
+TypeInterface* dictInterface(PyObject* dict)
+{
+  CommonPrimitiveKind keyKind;
+  CommonPrimitiveKind elementKind;
+  Py_ssize_t position = 0;
+  PyObject* key = nullptr;
+  PyObject* element = nullptr;
+  auto hasKeyKind = true;
+  auto hasElementKind = true;
+  while ((hasKeyKind || hasElementKind) && PyDict_Next(dict, &position, &key, &element))
+  {
+    hasKeyKind = hasKeyKind && keyKind.add(key);
+    hasElementKind = hasElementKind && elementKind.add(element);
+  }
+
+  return invokeWithInterfaceOf(keyKind.kind(), [&](auto keyTag) -> TypeInterface* {
+    return invokeWithInterfaceOf(elementKind.kind(), [](auto elementTag) -> TypeInterface* {
+      using KeyInterface = typename decltype(keyTag)::type;
+      using ElementInterface = typename decltype(elementTag)::type;
+      return instance<types::DictInterface<::py::object, KeyInterface, ElementInterface>>();
+    });
+  });
+}
+
+/// Returns the kind of the objects of a type hint, if it is one of the
+/// primitive types.
+PrimitiveKind primitiveKindOfHint(::py::handle hint)
+{
+  const auto type = hint.ptr();
+  if (type == reinterpret_cast<PyObject*>(&PyBool_Type))
+    return PrimitiveKind::Bool;
+  if (type == reinterpret_cast<PyObject*>(&PyLong_Type))
+    return PrimitiveKind::Int;
+  if (type == reinterpret_cast<PyObject*>(&PyFloat_Type))
+    return PrimitiveKind::Float;
+  if (type == reinterpret_cast<PyObject*>(&PyUnicode_Type))
+    return PrimitiveKind::Str;
+  return PrimitiveKind::None;
+}
+
+/// Abstract types of the numpy scalars, whose instances are converted as
+/// primitive values.
+struct NumpyScalarTypes
+{
+  PyObject* boolean;
+  PyObject* integer;
+  PyObject* floating;
+};
+
+/// Returns the kind of the primitive value of an object if it is a numpy
+/// scalar of a boolean, integer or floating point number type, or
+/// `PrimitiveKind::None` otherwise.
+///
+/// The name of the type of the object filters out any other object before any
+/// lookup. As instances of numpy types only exist once numpy is imported, the
+/// module is then already loaded. Its types are leaked, as the module is never
+/// unloaded. If a subclass check fails, its error is cleared and the object is
+/// not a numpy scalar.
+///
+/// @pre The GIL is locked.
+PrimitiveKind numpyScalarKind(PyObject* obj)
+{
+  if (std::strncmp(Py_TYPE(obj)->tp_name, "numpy.", 6) != 0)
+    return PrimitiveKind::None;
+
+  // Protected by the GIL.
+  static const NumpyScalarTypes* types = nullptr;
+  if (!types)
+  {
+    const auto numpy = ::py::module::import("numpy");
+    types = new NumpyScalarTypes{ numpy.attr("bool_").release().ptr(),
+                                  numpy.attr("integer").release().ptr(),
+                                  numpy.attr("floating").release().ptr() };
+  }
+
+  const auto type = reinterpret_cast<PyObject*>(Py_TYPE(obj));
+  const std::pair<PyObject*, PrimitiveKind> kinds[] = {
+    { types->boolean, PrimitiveKind::Bool },
+    { types->integer, PrimitiveKind::Int },
+    { types->floating, PrimitiveKind::Float },
+  };
+  for (const auto& typeAndKind : kinds)
+  {
+    const auto isSubclass = PyObject_IsSubclass(type, typeAndKind.first);
+    if (isSubclass < 0)
+    {
+      // The check failed and set an error, which must not leak into the
+      // conversion: the object is then converted as any other object.
+      PyErr_Clear();
+      return PrimitiveKind::None;
+    }
+    if (isSubclass == 1)
+      return typeAndKind.second;
+  }
+  return PrimitiveKind::None;
+}
+
+} // namespace
+
 AnyReference unwrapAsRef(pybind11::object& obj)
 {
   QI_ASSERT_TRUE(obj);
@@ -782,7 +2684,6 @@ AnyReference unwrapAsRef(pybind11::object& obj)
 
   if (   ::py::isinstance<::py::ellipsis>(*obj)
       || PyComplex_CheckExact(obj.ptr())
-      || ::py::isinstance<::py::memoryview>(*obj)
       || ::py::isinstance<::py::slice>(*obj)
       || ::py::isinstance<::py::module>(*obj))
   {
@@ -813,34 +2714,347 @@ AnyReference unwrapAsRef(pybind11::object& obj)
     return AnyReference(instance<types::StringBufferInterface<::py::object>>(), pybindObjPtr);
 
   if (PyTuple_CheckExact(pyObjPtr))
-    return AnyReference(instance<types::StructuredIterableInterface<::py::object>>(
-                          ::py::tuple(obj).size()),
+    return AnyReference(sizedInstance<types::StructuredIterableInterface<::py::object>>(
+                          PyTuple_GET_SIZE(pyObjPtr)),
                         pybindObjPtr);
 
   // Checks if it is AnySet, meaning it can be a set or a frozenset.
   if (PyAnySet_CheckExact(pyObjPtr))
-    return AnyReference(instance<types::StructuredIterableInterface<::py::object>>(
-                          ::py::set(obj).size()),
+    return AnyReference(sizedInstance<types::StructuredIterableInterface<::py::object>>(
+                          PySet_GET_SIZE(pyObjPtr)),
                         pybindObjPtr);
 
-  if (PyList_CheckExact(pyObjPtr) || PyDictViewSet_Check(pyObjPtr) || PyDictValues_Check(pyObjPtr))
+  if (PyList_CheckExact(pyObjPtr))
+    return AnyReference(listInterface(pyObjPtr), pybindObjPtr);
+
+  if (PyDictViewSet_Check(pyObjPtr) || PyDictValues_Check(pyObjPtr))
     return AnyReference(instance<types::ListInterface<::py::object, ::py::list>>(), pybindObjPtr);
 
   if (PyDict_CheckExact(pyObjPtr))
-    return AnyReference(instance<types::DictInterface<::py::object>>(), pybindObjPtr);
+    return AnyReference(dictInterface(pyObjPtr), pybindObjPtr);
+
+  if (const auto structClass = structClasses().find(Py_TYPE(pyObjPtr)))
+    return AnyReference(structClass->type, pybindObjPtr);
+
+  // Instances of subclasses of the builtin types (IntEnum members, numpy.float64,
+  // OrderedDict...) are read through the builtin part of their data, as the
+  // exact instances above. They are checked after them, as these checks are
+  // more expensive for some of the types.
+  if (PyLong_Check(pyObjPtr))
+    return AnyReference(instance<types::IntInterface<::py::object>>(), pybindObjPtr);
+
+  if (PyFloat_Check(pyObjPtr))
+    return AnyReference(instance<types::FloatInterface<::py::object>>(), pybindObjPtr);
+
+  if (PyUnicode_Check(pyObjPtr))
+    return AnyReference(instance<types::StrInterface<::py::object>>(), pybindObjPtr);
+
+  if (PyBytes_Check(pyObjPtr) || PyByteArray_Check(pyObjPtr))
+    return AnyReference(instance<types::StringBufferInterface<::py::object>>(), pybindObjPtr);
+
+  if (PyTuple_Check(pyObjPtr))
+    return AnyReference(sizedInstance<types::StructuredIterableInterface<::py::object>>(
+                          PyTuple_GET_SIZE(pyObjPtr)),
+                        pybindObjPtr);
+
+  if (PyAnySet_Check(pyObjPtr))
+    return AnyReference(sizedInstance<types::StructuredIterableInterface<::py::object>>(
+                          PySet_GET_SIZE(pyObjPtr)),
+                        pybindObjPtr);
+
+  if (PyList_Check(pyObjPtr))
+    return AnyReference(listInterface(pyObjPtr), pybindObjPtr);
+
+  if (PyDict_Check(pyObjPtr))
+    return AnyReference(dictInterface(pyObjPtr), pybindObjPtr);
+
+  // Numpy scalars are checked before buffers, as they export zero-dimensional
+  // buffers of their value.
+  switch (numpyScalarKind(pyObjPtr))
+  {
+    case PrimitiveKind::Bool:
+      return AnyReference(instance<types::BoolInterface<::py::object>>(), pybindObjPtr);
+    case PrimitiveKind::Int:
+      return AnyReference(instance<types::IntInterface<::py::object>>(), pybindObjPtr);
+    case PrimitiveKind::Float:
+      return AnyReference(instance<types::FloatInterface<::py::object>>(), pybindObjPtr);
+    default:
+      break;
+  }
+
+  if (auto* const listType = numericBufferListInterface(obj))
+    return AnyReference(listType, pybindObjPtr);
+
+  if (hasContiguousBuffer(obj))
+    return AnyReference(instance<types::RawBufferInterface<::py::object>>(), pybindObjPtr);
+
+  if (auto container = viewedContainer(obj))
+    return *container;
 
   // At the moment in libqi, the `LogLevel` type is not registered in the qi type system. If we use
   // `AnyValue::from` with a `LogLevel` value, we get a value with a dummy type that cannot be set
   // or read. Furthermore, when registered with the `QI_TYPE_ENUM` macro, enumeration types are
   // treated as `int` values. This forces us to cast it here as an `int` to try to stay compatible.
   if (::py::isinstance<LogLevel>(obj))
+    return associateValueToObj(obj, [&] { return static_cast<int>(obj.cast<LogLevel>()); });
+
+  return associateValueToObj(obj, [&] { return py::toObject(obj); });
+}
+
+namespace
+{
+
+::py::object genericToPyObject(AnyReference value)
+{
+  return unwrapValue(value);
+}
+
+AnyValue genericFromPyObject(const ::py::object& obj)
+{
+  return AnyValue(AnyReference::from(obj).content().clone(), false, true);
+}
+
+/// Converts a value of a primitive type to a Python object directly if it is
+/// of the expected kind.
+///
+/// @pre The kind is either `TypeKind_Int`, `TypeKind_Float` or
+///      `TypeKind_String`.
+template<TypeKind kind>
+::py::object primitiveToPyObjectStep(AnyReference value)
+{
+  if (value.kind() != kind)
+    return genericToPyObject(value);
+
+  auto obj = ::py::reinterpret_steal<::py::object>(
+    primitiveToPyObject(value.type(), value.rawValue()));
+  if (!obj)
+    throw ::py::error_already_set();
+  return obj;
+}
+
+AnyValue boolFromPyObjectStep(const ::py::object& obj)
+{
+  if (!PyBool_Check(obj.ptr()))
+    return genericFromPyObject(obj);
+  return AnyValue::from(obj.ptr() == Py_True);
+}
+
+/// Converts a Python integer to an integer of type T directly if it is in the
+/// range of T. Otherwise, the generic conversion reports the error.
+template<typename T>
+AnyValue intFromPyObjectStep(const ::py::object& obj)
+{
+  if (!PyLong_Check(obj.ptr()))
+    return genericFromPyObject(obj);
+
+  if constexpr (std::is_signed<T>::value)
+  {
+    int overflow = 0;
+    const auto value = PyLong_AsLongLongAndOverflow(obj.ptr(), &overflow);
+    if (!overflow && value >= std::numeric_limits<T>::min()
+        && value <= std::numeric_limits<T>::max())
+      return AnyValue::from(static_cast<T>(value));
+  }
+  else
+  {
+    const auto value = PyLong_AsUnsignedLongLong(obj.ptr());
+    if (PyErr_Occurred())
+      PyErr_Clear();
+    else if (value <= std::numeric_limits<T>::max())
+      return AnyValue::from(static_cast<T>(value));
+  }
+  return genericFromPyObject(obj);
+}
+
+template<typename T>
+AnyValue floatFromPyObjectStep(const ::py::object& obj)
+{
+  if (!PyFloat_Check(obj.ptr()))
+    return genericFromPyObject(obj);
+  return AnyValue::from(static_cast<T>(PyFloat_AS_DOUBLE(obj.ptr())));
+}
+
+ConversionPlan::Step compileStep(const Signature& signature)
+{
+  switch (signature.type())
+  {
+    case Signature::Type_Bool:
+      return { &primitiveToPyObjectStep<TypeKind_Int>, &boolFromPyObjectStep };
+    case Signature::Type_Int8:
+      return { &primitiveToPyObjectStep<TypeKind_Int>, &intFromPyObjectStep<std::int8_t> };
+    case Signature::Type_UInt8:
+      return { &primitiveToPyObjectStep<TypeKind_Int>, &intFromPyObjectStep<std::uint8_t> };
+    case Signature::Type_Int16:
+      return { &primitiveToPyObjectStep<TypeKind_Int>, &intFromPyObjectStep<std::int16_t> };
+    case Signature::Type_UInt16:
+      return { &primitiveToPyObjectStep<TypeKind_Int>, &intFromPyObjectStep<std::uint16_t> };
+    case Signature::Type_Int32:
+      return { &primitiveToPyObjectStep<TypeKind_Int>, &intFromPyObjectStep<std::int32_t> };
+    case Signature::Type_UInt32:
+      return { &primitiveToPyObjectStep<TypeKind_Int>, &intFromPyObjectStep<std::uint32_t> };
+    case Signature::Type_Int64:
+      return { &primitiveToPyObjectStep<TypeKind_Int>, &intFromPyObjectStep<std::int64_t> };
+    case Signature::Type_UInt64:
+      return { &primitiveToPyObjectStep<TypeKind_Int>, &intFromPyObjectStep<std::uint64_t> };
+    case Signature::Type_Float:
+      return { &primitiveToPyObjectStep<TypeKind_Float>, &floatFromPyObjectStep<float> };
+    case Signature::Type_Double:
+      return { &primitiveToPyObjectStep<TypeKind_Float>, &floatFromPyObjectStep<double> };
+    case Signature::Type_String:
+      // Python strings are borrowed by the generic conversion, which is cheaper
+      // than copying them.
+      return { &primitiveToPyObjectStep<TypeKind_String>, &genericFromPyObject };
+    default:
+      return { &genericToPyObject, &genericFromPyObject };
+  }
+}
+
+} // namespace
+
+ConversionPlan::ConversionPlan(const Signature& parametersSignature,
+                               const Signature& returnSignature)
+  : _result(compileStep(returnSignature))
+{
+  // Parameters that are not a tuple (i.e. dynamic) have no step and are
+  // converted by the generic conversion.
+  if (parametersSignature.type() != Signature::Type_Tuple)
+    return;
+
+  const auto& children = parametersSignature.children();
+  _parameters.reserve(children.size());
+  for (const auto& child : children)
+    _parameters.push_back(compileStep(child));
+}
+
+std::shared_ptr<const ConversionPlan> ConversionPlan::of(const Signature& parametersSignature,
+                                                         const Signature& returnSignature)
+{
+  using Key = std::pair<std::string, std::string>;
+  static std::mutex mutex;
+  static std::map<Key, std::shared_ptr<const ConversionPlan>> plans;
+
+  Key key(parametersSignature.toString(), returnSignature.toString());
+  std::scoped_lock<std::mutex> lock(mutex);
+  auto& plan = plans[std::move(key)];
+  if (!plan)
+    plan = std::make_shared<const ConversionPlan>(parametersSignature, returnSignature);
+  return plan;
+}
+
+void registerStructClass(const ::py::object& cls, const std::string& name)
+{
+  GILAcquire lock;
+
+  if (!PyType_Check(cls.ptr()))
+    throw ::py::type_error("only classes can be registered as structure types");
+
+  const auto dataclasses = ::py::module::import("dataclasses");
+  std::vector<std::string> fieldNames;
+  bool isTuple = false;
+  if (PyType_IsSubtype(reinterpret_cast<PyTypeObject*>(cls.ptr()), &PyTuple_Type)
+      && ::py::hasattr(cls, "_fields"))
+  {
+    isTuple = true;
+    for (const auto field : cls.attr("_fields"))
+      fieldNames.push_back(field.cast<std::string>());
+  }
+  else if (dataclasses.attr("is_dataclass")(cls).cast<bool>())
+  {
+    for (const auto field : dataclasses.attr("fields")(cls))
+      fieldNames.push_back(field.attr("name").cast<std::string>());
+  }
+  else
+    throw ::py::type_error("only dataclasses and NamedTuple classes can be registered as "
+                           "structure types");
+
+  // Fields annotated with a primitive type have the type of that primitive,
+  // and the other ones are dynamic. If the annotations cannot be resolved (a
+  // forward reference to a name that is not defined yet, for instance), all
+  // the fields are dynamic.
+  ::py::dict hints;
+  try
+  {
+    hints = ::py::module::import("typing").attr("get_type_hints")(cls);
+  }
+  catch (const ::py::error_already_set& ex)
+  {
+    qiLogVerbose() << "Could not get the type hints of the structure class " << name
+                   << ", its fields are dynamic: " << ex.what();
+  }
+  std::vector<TypeInterface*> memberTypes;
+  memberTypes.reserve(fieldNames.size());
+  for (const auto& fieldName : fieldNames)
   {
-    const auto logLevel = obj.cast<LogLevel>();
-    const auto logLevelValue = static_cast<int>(logLevel);
-    return associateValueToObj(obj, logLevelValue);
+    const auto kind = hints.contains(fieldName) ? primitiveKindOfHint(hints[fieldName.c_str()])
+                                                : PrimitiveKind::None;
+    memberTypes.push_back(invokeWithInterfaceOf(kind, [](auto tag) -> TypeInterface* {
+      return instance<typename decltype(tag)::type>();
+    }));
   }
 
-  return associateValueToObj(obj, py::toObject(obj));
+  // The interface is never destroyed, as references of this type may outlive
+  // the registration.
+  auto* const type = new types::StructClassInterface<::py::object>(name, fieldNames,
+                                                                   memberTypes, isTuple);
+  structClasses().add(std::make_shared<const StructClass>(
+    StructClass{ cls, name, std::move(fieldNames), type }));
+}
+
+void exportTypes(::py::module& m)
+{
+  using namespace ::py;
+  using namespace ::py::literals;
+
+  GILAcquire lock;
+
+  m.def("setNumpyArrayConversion", &setNumpyArrayConversionEnabled, "enabled"_a,
+        doc("Enable or disable the conversion of lists of numbers to numpy arrays.\n"
+            "When enabled, lists of integers or floating point numbers are converted "
+            "to one-dimensional numpy arrays instead of lists. It is disabled by default.\n"
+            "It can also be enabled or disabled for a single synchronous call of a method "
+            "of an object, with the `_numpy` keyword argument.\n"
+            ":param enabled: whether the conversion is enabled.\n"
+            ":raises ImportError: if the conversion is enabled and numpy is not available."));
+
+  m.def("numpyArrayConversion", &numpyArrayConversionEnabled,
+        doc(":returns: whether lists of numbers are converted to numpy arrays."));
+
+  m.def("setColumnarConversion", &setColumnarConversionEnabled, "enabled"_a,
+        doc("Enable or disable the conversion of lists of structures to columns.\n"
+            "When enabled, lists of structures (such as `[(dd)]`) are converted to "
+            "dicts of one column per member, keyed by the names of the members or by "
+            "their indices. Columns of numbers are numpy arrays if the conversion to "
+            "numpy arrays is enabled, `array.array` objects otherwise, and other columns "
+            "are lists. It is disabled by default.\n"
+            "It can also be enabled or disabled for a single synchronous call of a method "
+            "of an object, with the `_columnar` keyword argument.\n"
+            ":param enabled: whether the conversion is enabled."));
+
+  m.def("columnarConversion", &columnarConversionEnabled,
+        doc(":returns: whether lists of structures are converted to columns."));
+
+  m.def("registerStruct",
+        [](const object& cls, const object& name) {
+          registerStructClass(cls, name.is_none() ? cls.attr("__name__").cast<std::string>()
+                                                  : name.cast<std::string>());
+          return cls;
+        },
+        "cls"_a, "name"_a = none(),
+        doc("Register a dataclass or a NamedTuple class as a structure type.\n"
+            "Instances of the class are converted to structures whose members are "
+            "the fields of the class, and structures with the name and the fields of "
+            "the class are converted to instances of the class. Fields annotated with "
+            "`bool`, `int`, `float` or `str` have that type, other fields are dynamic.\n"
+            "It can be used as a class decorator.\n"
+            ":param cls: the class.\n"
+            ":param name: the name of the structure type, which is the name of the "
+            "class by default.\n"
+            ":returns: the class."));
+
+  module::import("atexit").attr("register")(cpp_function([] {
+    internedKeys().clear();
+    structClasses().clear();
+  }));
 }
 
 void registerTypes()
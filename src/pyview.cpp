@@ -0,0 +1,416 @@
+/*
+**  Copyright (C) 2023 Aldebaran Robotics
+**  See COPYING for the license
+*/
+
+#include <qipython/pyview.hpp>
+#include <qipython/common.hpp>
+#include <qipython/pyguard.hpp>
+#include <qipython/pytypes.hpp>
+#include <pybind11/pybind11.h>
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace py = pybind11;
+
+namespace qi
+{
+namespace py
+{
+
+namespace
+{
+
+std::atomic<bool> lazyContainerViewsGloballyEnabled{ false };
+thread_local boost::optional<bool> lazyContainerViewsEnabledInThread;
+
+using Root = std::shared_ptr<const AnyValue>;
+
+/// Root of the views created in the current thread (see
+/// `ContainerViewsRootScope`), such as while a view converts one of its
+/// elements. Views of the containers nested in that element share it instead
+/// of copying their container.
+thread_local Root currentRoot;
+
+/// Lazy view of a container, which is part of a value, the root, that is
+/// shared by the views of all the containers nested in it. Elements are
+/// converted to Python objects when they are accessed.
+///
+/// Views are only used with the GIL locked, which protects them.
+class ContainerView
+{
+public:
+  ContainerView(Root root, AnyReference container)
+    : _root(std::move(root))
+    , _container(container)
+  {
+  }
+
+  AnyReference container() const
+  {
+    return _container;
+  }
+
+  std::size_t size() const
+  {
+    return _container.size();
+  }
+
+  ::py::object materialize() const
+  {
+    LazyContainerViewsScope eager(false);
+    return unwrapValue(_container);
+  }
+
+  bool equal(const ::py::object& other) const
+  {
+    if (const auto otherContainer = viewedContainer(other))
+    {
+      LazyContainerViewsScope eager(false);
+      return materialize().equal(unwrapValue(*otherContainer));
+    }
+    return materialize().equal(other);
+  }
+
+protected:
+  /// Converts an element of the container. Its nested containers are views
+  /// that share the root of this view, whatever the setting of the thread.
+  ::py::object elementToPyObject(AnyReference element) const
+  {
+    LazyContainerViewsScope lazy(true);
+    ContainerViewsRootScope scope(_root);
+    return unwrapValue(element);
+  }
+
+  Root _root;
+  AnyReference _container;
+};
+
+class ListView : public ContainerView
+{
+public:
+  /// Iterator of a view, which walks the list once with an iterator of the
+  /// container, instead of looking up each element by its index.
+  class Iterator;
+
+  using ContainerView::ContainerView;
+
+  ::py::object item(::py::ssize_t index) const
+  {
+    const auto size = static_cast<::py::ssize_t>(this->size());
+    if (index < 0)
+      index += size;
+    if (index < 0 || index >= size)
+      throw ::py::index_error("list view index out of range");
+    return elementToPyObject(element(static_cast<std::size_t>(index)));
+  }
+
+  ::py::list slice(const ::py::slice& slice) const
+  {
+    std::size_t start = 0, stop = 0, step = 0, length = 0;
+    if (!slice.compute(size(), &start, &stop, &step, &length))
+      throw ::py::error_already_set();
+
+    ::py::list res(length);
+    for (std::size_t i = 0; i < length; ++i, start += step)
+      res[i] = elementToPyObject(element(start));
+    return res;
+  }
+
+  Iterator iter() const;
+
+  std::string repr() const
+  {
+    return "ListView(" + ::py::repr(materialize()).cast<std::string>() + ")";
+  }
+
+private:
+  AnyReference element(std::size_t index) const
+  {
+    return elements()[index];
+  }
+
+  /// Returns the elements of the list, which are gathered on the first
+  /// request in a single traversal, as the lists of libqi do not all have
+  /// random access.
+  const std::vector<AnyReference>& elements() const
+  {
+    if (_elements)
+      return *_elements;
+
+    std::vector<AnyReference> elements;
+    elements.reserve(size());
+    const auto end = _container.end();
+    for (auto it = _container.begin(); it != end; ++it)
+      elements.push_back(*it);
+    _elements = std::move(elements);
+    return *_elements;
+  }
+
+  mutable boost::optional<std::vector<AnyReference>> _elements;
+};
+
+class ListView::Iterator
+{
+public:
+  explicit Iterator(ListView view)
+    : _view(std::move(view))
+    , _it(_view._container.begin())
+    , _end(_view._container.end())
+  {
+  }
+
+  ::py::object next()
+  {
+    if (_it == _end)
+      throw ::py::stop_iteration();
+    const auto element = *_it;
+    ++_it;
+    return _view.elementToPyObject(element);
+  }
+
+private:
+  ListView _view;
+  AnyIterator _it;
+  AnyIterator _end;
+};
+
+ListView::Iterator ListView::iter() const
+{
+  return Iterator(*this);
+}
+
+class MapView : public ContainerView
+{
+public:
+  using ContainerView::ContainerView;
+
+  ::py::object item(const ::py::object& key) const
+  {
+    const auto* const element = find(key);
+    if (!element)
+      throw ::py::key_error(::py::repr(key).cast<std::string>());
+    return elementToPyObject(*element);
+  }
+
+  ::py::object get(const ::py::object& key, const ::py::object& defaultValue) const
+  {
+    const auto* const element = find(key);
+    return element ? elementToPyObject(*element) : defaultValue;
+  }
+
+  bool contains(const ::py::object& key) const
+  {
+    return find(key) != nullptr;
+  }
+
+  ::py::list keys() const
+  {
+    return index().keys;
+  }
+
+  ::py::list values() const
+  {
+    const auto& idx = index();
+    ::py::list res(idx.elements.size());
+    for (std::size_t i = 0; i < idx.elements.size(); ++i)
+      res[i] = elementToPyObject(idx.elements[i]);
+    return res;
+  }
+
+  ::py::list items() const
+  {
+    const auto& idx = index();
+    ::py::list res(idx.elements.size());
+    for (std::size_t i = 0; i < idx.elements.size(); ++i)
+      res[i] = ::py::make_tuple(idx.keys[i], elementToPyObject(idx.elements[i]));
+    return res;
+  }
+
+  ::py::iterator iter() const
+  {
+    return ::py::iter(index().keys);
+  }
+
+  std::string repr() const
+  {
+    return "MapView(" + ::py::repr(materialize()).cast<std::string>() + ")";
+  }
+
+private:
+  /// Keys of the map converted to Python objects, with the positions of their
+  /// elements, in the order of the map.
+  struct Index
+  {
+    ::py::list keys;
+    ::py::dict positions;
+    std::vector<AnyReference> elements;
+  };
+
+  /// Returns the index of the map, which is built on the first request. Keys
+  /// are looked up in Python, with the equality of Python objects, so that any
+  /// key that compares equal to a key of the map finds its element. Keys are
+  /// converted eagerly, as views cannot be hashed, and elements are not
+  /// converted.
+  const Index& index() const
+  {
+    if (_index)
+      return *_index;
+
+    LazyContainerViewsScope eager(false);
+    Index idx;
+    idx.elements.reserve(size());
+    const auto end = _container.end();
+    for (auto it = _container.begin(); it != end; ++it)
+    {
+      auto pair = *it;
+      auto key = unwrapValue(pair[0]);
+      idx.positions[key] = idx.elements.size();
+      idx.keys.append(std::move(key));
+      idx.elements.push_back(pair[1]);
+    }
+    _index = std::move(idx);
+    return *_index;
+  }
+
+  const AnyReference* find(const ::py::object& key) const
+  {
+    const auto& idx = index();
+    const auto position = PyDict_GetItemWithError(idx.positions.ptr(), key.ptr());
+    if (!position)
+    {
+      if (PyErr_Occurred())
+        throw ::py::error_already_set();
+      return nullptr;
+    }
+    return &idx.elements[::py::handle(position).cast<std::size_t>()];
+  }
+
+  mutable boost::optional<Index> _index;
+};
+
+} // namespace
+
+bool lazyContainerViewsEnabled()
+{
+  if (lazyContainerViewsEnabledInThread)
+    return *lazyContainerViewsEnabledInThread;
+  return lazyContainerViewsGloballyEnabled.load();
+}
+
+void setLazyContainerViewsEnabled(bool enabled)
+{
+  lazyContainerViewsGloballyEnabled.store(enabled);
+}
+
+LazyContainerViewsScope::LazyContainerViewsScope(bool enabled)
+  : _previous(lazyContainerViewsEnabledInThread)
+{
+  lazyContainerViewsEnabledInThread = enabled;
+}
+
+LazyContainerViewsScope::~LazyContainerViewsScope()
+{
+  lazyContainerViewsEnabledInThread = _previous;
+}
+
+ContainerViewsRootScope::ContainerViewsRootScope(std::shared_ptr<const AnyValue> root)
+  : _previous(std::exchange(currentRoot, std::move(root)))
+{
+}
+
+ContainerViewsRootScope::~ContainerViewsRootScope()
+{
+  currentRoot = std::move(_previous);
+}
+
+boost::optional<::py::object> tryContainerToView(AnyReference value)
+{
+  const auto kind = value.kind();
+  if (kind != TypeKind_List && kind != TypeKind_Map)
+    return {};
+
+  // Without a root that contains it, the value is copied to become the root
+  // of a new view.
+  auto root = currentRoot;
+  if (!root)
+  {
+    root = std::make_shared<const AnyValue>(value);
+    value = root->asReference();
+  }
+
+  if (kind == TypeKind_List)
+    return castToPyObject(ListView(std::move(root), value));
+  return castToPyObject(MapView(std::move(root), value));
+}
+
+boost::optional<AnyReference> viewedContainer(const ::py::object& obj)
+{
+  if (::py::isinstance<ListView>(obj))
+    return obj.cast<const ListView&>().container();
+  if (::py::isinstance<MapView>(obj))
+    return obj.cast<const MapView&>().container();
+  return {};
+}
+
+void exportView(::py::module& m)
+{
+  using namespace ::py;
+  using namespace ::py::literals;
+
+  GILAcquire lock;
+
+  m.def("setLazyContainerViews", &setLazyContainerViewsEnabled, "enabled"_a,
+        doc("Enable or disable the conversion of lists and maps to lazy views.\n"
+            "When enabled, lists and maps are converted to `ListView` and `MapView` "
+            "objects, which convert their elements only when they are accessed. It is "
+            "disabled by default.\n"
+            "It can also be enabled or disabled for a single synchronous call of a method "
+            "of an object, with the `_lazy` keyword argument.\n"
+            ":param enabled: whether the conversion is enabled."));
+
+  m.def("lazyContainerViews", &lazyContainerViewsEnabled,
+        doc(":returns: whether lists and maps are converted to lazy views."));
+
+  class_<ListView>(m, "ListView",
+                   doc("Read-only view of a list, whose elements are converted when they "
+                       "are accessed. A view passed back to a call is not converted again."))
+    .def("__len__", &ListView::size)
+    .def("__getitem__", &ListView::item, "index"_a)
+    .def("__getitem__", &ListView::slice, "slice"_a)
+    .def("__iter__", &ListView::iter)
+    .def("__eq__", &ListView::equal, "other"_a)
+    .def("__repr__", &ListView::repr)
+    .def("materialize", &ListView::materialize,
+         doc(":returns: the list, with all its elements converted."));
+
+  class_<ListView::Iterator>(m, "ListViewIterator")
+    .def("__iter__", [](ListView::Iterator& it) -> ListView::Iterator& { return it; },
+         return_value_policy::reference_internal)
+    .def("__next__", &ListView::Iterator::next);
+
+  class_<MapView>(m, "MapView",
+                  doc("Read-only view of a map, whose elements are converted when they "
+                      "are accessed. A view passed back to a call is not converted again."))
+    .def("__len__", &MapView::size)
+    .def("__getitem__", &MapView::item, "key"_a)
+    .def("__contains__", &MapView::contains, "key"_a)
+    .def("__iter__", &MapView::iter)
+    .def("__eq__", &MapView::equal, "other"_a)
+    .def("__repr__", &MapView::repr)
+    .def("get", &MapView::get, "key"_a, "default"_a = none())
+    .def("keys", &MapView::keys)
+    .def("values", &MapView::values)
+    .def("items", &MapView::items)
+    .def("materialize", &MapView::materialize,
+         doc(":returns: the dict, with all its elements converted."));
+
+  const auto abc = module::import("collections.abc");
+  abc.attr("Sequence").attr("register")(m.attr("ListView"));
+  abc.attr("Mapping").attr("register")(m.attr("MapView"));
+}
+
+} // namespace py
+} // namespace qi
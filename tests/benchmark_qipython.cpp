@@ -0,0 +1,412 @@
+/*
+**  Copyright (C) 2023 Aldebaran Robotics
+**  See COPYING for the license
+*/
+
+// Benchmarks of the conversions between Python objects and qi values.
+//
+// This program is not a test: it prints the mean duration of each benchmark on
+// the standard output, so that measures can be compared between revisions.
+// Benchmarks of an optimization also measure a reference implementation of the
+// code as it was before, and print the speedup of the current code over it.
+
+#include <qipython/common.hpp>
+#include <qipython/pyguard.hpp>
+#include <qipython/pytypes.hpp>
+#include <qipython/pyexport.hpp>
+#include <pybind11/pybind11.h>
+#include <pybind11/embed.h>
+#include <qi/binarycodec.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace py = pybind11;
+
+PYBIND11_EMBEDDED_MODULE(qi, m) {
+  qi::py::exportAll(m);
+}
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+using Duration = std::chrono::nanoseconds;
+
+// Invokes the procedure a number of times and returns the mean duration of an
+// invocation.
+template<typename Proc>
+Duration measure(std::size_t runs, Proc&& proc)
+{
+  const auto start = Clock::now();
+  for (std::size_t i = 0; i < runs; ++i)
+    proc();
+  return std::chrono::duration_cast<Duration>(Clock::now() - start) / runs;
+}
+
+void report(const std::string& name, Duration duration)
+{
+  std::cout << std::left << std::setw(72) << name
+            << std::right << std::setw(14) << duration.count() << " ns"
+            << std::endl;
+}
+
+// Reports the ratio of the duration of a reference implementation to the
+// duration of the current one.
+void reportSpeedup(const std::string& name, Duration reference, Duration current)
+{
+  const auto ratio = current.count() > 0
+                       ? static_cast<double>(reference.count()) / current.count()
+                       : 0.;
+  std::cout << std::left << std::setw(72) << name + " speedup"
+            << std::right << std::setw(14) << std::fixed << std::setprecision(2) << ratio
+            << " x" << std::endl;
+}
+
+using References = qi::py::detail::DisownedReferencesStorage::References;
+
+// Disowned references storage with a single lock, as it was before it was split
+// in shards. It serves as a reference for the measures of the current storage,
+// whose interface used by conversions it implements.
+class SingleLockDisownedReferencesStorage
+{
+public:
+  template<typename Make>
+  qi::AnyReference storeOnceAt(void* context, std::uintptr_t slot, Make&& make)
+  {
+    std::scoped_lock<std::mutex> lock(_mutex);
+    auto& ref = _references[context].slots[slot];
+    if (!ref.isValid())
+      ref = std::forward<Make>(make)();
+    return ref;
+  }
+
+  std::shared_ptr<qi::py::detail::ElementReferences> elementReferences(void* context,
+                                                                       std::size_t)
+  {
+    std::scoped_lock<std::mutex> lock(_mutex);
+    auto& elements = _references[context].elements;
+    if (!elements)
+      elements = std::make_shared<qi::py::detail::ElementReferences>();
+    return elements;
+  }
+
+  References unstore(void* context)
+  {
+    std::scoped_lock<std::mutex> lock(_mutex);
+    auto it = _references.find(context);
+    if (it == _references.end())
+      return {};
+
+    auto res = std::move(it->second);
+    _references.erase(it);
+    return res;
+  }
+
+private:
+  std::mutex _mutex;
+  std::map<void*, References> _references;
+};
+
+// Destroys the references of a context, as the destruction of the value that
+// the context is the storage of does.
+void destroyReferences(References refs)
+{
+  for (auto& slotRef : refs.slots)
+  {
+    if (slotRef.second.isValid())
+      slotRef.second.destroy();
+  }
+}
+
+// Each thread reads containers of its own, then destroys them, as concurrent
+// conversions of different values do. A read of a container gets the reference
+// of its context stored at a slot (such as the export of a buffer), then the
+// references to its elements. Returns the duration of the whole run.
+template<typename Storage>
+Duration readContainersConcurrently(std::size_t threadCount)
+{
+  constexpr std::size_t contextCount = 1000;
+  constexpr std::size_t readCount = 4;
+  constexpr std::size_t elementCount = 8;
+
+  const auto storage = std::make_unique<Storage>();
+  const auto makeRef = [] { return qi::AnyValue::from(42).release(); };
+  const auto reusable = [](qi::AnyReference) { return true; };
+  std::atomic<bool> started{ false };
+  std::vector<std::thread> threads;
+  for (std::size_t t = 0; t < threadCount; ++t)
+  {
+    threads.emplace_back([&] {
+      std::vector<std::unique_ptr<int>> contexts(contextCount);
+      for (auto& context : contexts)
+        context = std::make_unique<int>();
+
+      while (!started)
+        std::this_thread::yield();
+
+      for (std::size_t r = 0; r < readCount; ++r)
+      {
+        for (const auto& context : contexts)
+        {
+          storage->storeOnceAt(context.get(), 0, makeRef);
+          const auto elements = storage->elementReferences(context.get(), elementCount);
+          for (std::size_t e = 0; e < elementCount; ++e)
+            elements->at(e, reusable, makeRef);
+        }
+      }
+      for (const auto& context : contexts)
+        destroyReferences(storage->unstore(context.get()));
+    });
+  }
+
+  const auto start = Clock::now();
+  started = true;
+  for (auto& thread : threads)
+    thread.join();
+  return std::chrono::duration_cast<Duration>(Clock::now() - start);
+}
+
+void benchmarkDisownedReferencesStorage()
+{
+  constexpr std::size_t runs = 20;
+  for (const std::size_t threadCount : { 1, 2, 4, 8 })
+  {
+    const auto suffix = ", " + std::to_string(threadCount) + " threads";
+    const auto singleLock = measure(runs, [&] {
+      readContainersConcurrently<SingleLockDisownedReferencesStorage>(threadCount);
+    });
+    const auto sharded = measure(runs, [&] {
+      readContainersConcurrently<qi::py::detail::DisownedReferencesStorage>(threadCount);
+    });
+    report("disowned references storage (single lock)" + suffix, singleLock);
+    report("disowned references storage (sharded)" + suffix, sharded);
+    reportSpeedup("disowned references storage" + suffix, singleLock, sharded);
+  }
+}
+
+// Converts a list element by element, each one through a full dispatch on its
+// type, as the conversion of lists did before homogeneous lists had a fast
+// path. It serves as a reference for the measures of the current conversion.
+py::object listToPyObjectByElement(qi::AnyReference list)
+{
+  py::list res;
+  const auto end = list.end();
+  for (auto it = list.begin(); it != end; ++it)
+    res.append(qi::py::unwrapValue(*it));
+  return std::move(res);
+}
+
+template<typename T>
+void benchmarkHomogeneousListConversion(const std::string& typeName, const T& value)
+{
+  constexpr std::size_t runs = 20;
+  constexpr std::size_t size = 100000;
+  const std::vector<T> values(size, value);
+  const auto ref = qi::AnyReference::from(values);
+
+  const auto name = "list of " + std::to_string(size) + " " + typeName + " to Python";
+  const auto byElement = measure(runs, [&] { listToPyObjectByElement(ref); });
+  const auto direct = measure(runs, [&] { qi::py::unwrapValue(ref); });
+  report(name + " (by element)", byElement);
+  report(name, direct);
+  reportSpeedup(name, byElement, direct);
+}
+
+void benchmarkHomogeneousListsConversion()
+{
+  qi::py::GILAcquire lock;
+  benchmarkHomogeneousListConversion<double>("doubles", 3.14);
+  benchmarkHomogeneousListConversion<int>("ints", 42);
+  benchmarkHomogeneousListConversion<std::string>("strings", "cookies");
+}
+
+// Converts a map item by item through the `operator[]` of pybind11 dicts, as
+// the conversion of maps did before dicts were presized. It serves as a
+// reference for the measures of the current conversion.
+py::object mapToPyObjectByItem(qi::AnyReference map)
+{
+  py::dict res;
+  const auto end = map.end();
+  for (auto it = map.begin(); it != end; ++it)
+    res[qi::py::unwrapValue((*it)[0])] = qi::py::unwrapValue((*it)[1]);
+  return std::move(res);
+}
+
+void benchmarkMapsConversion()
+{
+  qi::py::GILAcquire lock;
+  for (const std::size_t size : { 10, 100, 1000, 10000 })
+  {
+    const std::size_t runs = 1000000 / size;
+    std::map<std::string, qi::AnyValue> values;
+    for (std::size_t i = 0; i < size; ++i)
+    {
+      const auto key = "key" + std::to_string(i);
+      if (i % 2 == 0)
+        values.emplace(key, qi::AnyValue::from(static_cast<double>(i)));
+      else
+        values.emplace(key, qi::AnyValue::from(key));
+    }
+    const auto ref = qi::AnyReference::from(values);
+
+    const auto name = "map of " + std::to_string(size) + " strings to values to Python";
+    const auto byItem = measure(runs, [&] { mapToPyObjectByItem(ref); });
+    const auto presized = measure(runs, [&] { qi::py::unwrapValue(ref); });
+    report(name + " (by item)", byItem);
+    report(name, presized);
+    reportSpeedup(name, byItem, presized);
+  }
+}
+
+// Serializes a Python string as it is sent, either from a copy of its UTF-8 data,
+// as strings were extracted before this data was borrowed, or from the string
+// itself.
+void benchmarkLargeStringSerialization(std::size_t size)
+{
+  constexpr std::size_t runs = 20;
+  py::object str = py::str(std::string(size, 'a'));
+  const auto ref = qi::py::unwrapAsRef(str);
+
+  const auto name = "serialization of a str of " + std::to_string(size) + " bytes";
+  const auto copy = measure(runs, [&] {
+    qi::Buffer buffer;
+    qi::encodeBinary(&buffer, qi::AnyReference::from(std::string(py::str(str))));
+  });
+  const auto borrowed = measure(runs, [&] {
+    qi::Buffer buffer;
+    qi::encodeBinary(&buffer, ref);
+  });
+  report(name + " (copy)", copy);
+  report(name, borrowed);
+  reportSpeedup(name, copy, borrowed);
+}
+
+void benchmarkLargeStringsSerialization()
+{
+  qi::py::GILAcquire lock;
+  benchmarkLargeStringSerialization(1024);
+  benchmarkLargeStringSerialization(1024 * 1024);
+  benchmarkLargeStringSerialization(16 * 1024 * 1024);
+}
+
+// Acquisition of the GIL as it was before nested acquisitions were counted: the
+// state of the interpreter and of the GIL is checked at every level. It serves
+// as a reference for the measures of the current guard.
+class CheckingGILAcquire
+{
+public:
+  CheckingGILAcquire()
+  {
+    if (qi::py::gilExistsAndCurrentThreadHoldsIt())
+      return;
+    if (qi::py::interpreterIsFinalizing().value_or(false))
+      throw qi::py::InterpreterFinalizingException();
+    _state = PyGILState_Ensure();
+  }
+
+  ~CheckingGILAcquire()
+  {
+    if (_state && qi::py::gilExistsAndCurrentThreadHoldsIt())
+      PyGILState_Release(*_state);
+  }
+
+private:
+  boost::optional<PyGILState_STATE> _state;
+};
+
+template<typename Guard>
+void acquireNested(std::size_t depth)
+{
+  Guard guard;
+  if (depth > 1)
+    acquireNested<Guard>(depth - 1);
+}
+
+void benchmarkNestedGILAcquisitions()
+{
+  qi::py::GILAcquire lock;
+  constexpr std::size_t runs = 100000;
+  constexpr std::size_t depth = 10;
+  const auto checked = measure(runs, [] { acquireNested<CheckingGILAcquire>(depth); });
+  const auto counted = measure(runs, [] { acquireNested<qi::py::GILAcquire>(depth); });
+  report("10 nested GIL acquisitions (checked)", checked);
+  report("10 nested GIL acquisitions", counted);
+  reportSpeedup("10 nested GIL acquisitions", checked, counted);
+
+  // The type interfaces of Python objects and the conversions of values
+  // acquire the GIL for each element of nested containers.
+  constexpr std::size_t conversionRuns = 100;
+  py::object obj = py::eval(
+    "[{'values': [float(i), float(i + 1)], 'label': str(i)} for i in range(1000)]");
+  const auto ref = qi::py::unwrapAsRef(obj);
+  report("serialization of 1000 nested Python containers", measure(conversionRuns, [&] {
+           qi::Buffer buffer;
+           qi::encodeBinary(&buffer, ref);
+         }));
+
+  const std::vector<std::map<std::string, std::vector<double>>> values(
+    1000, { { "values", { 1., 2. } }, { "other", { 3., 4. } } });
+  const auto valuesRef = qi::AnyReference::from(values);
+  report("1000 nested containers to Python",
+         measure(conversionRuns, [&] { qi::py::unwrapValue(valuesRef); }));
+}
+
+// Acquires the GIL from a thread that Python does not know of, as the worker
+// threads of libqi do when they call Python callbacks. Its thread state is only
+// created by its first acquisition.
+//
+// The reference acquires the GIL with `PyGILState_Ensure` alone, as it was
+// before thread states were kept: each acquisition creates a thread state, and
+// the matching release destroys it.
+void benchmarkNativeThreadGILAcquisition()
+{
+  constexpr std::size_t runs = 100000;
+  Duration transient;
+  std::thread transientThread([&] {
+    transient = measure(runs, [] { PyGILState_Release(PyGILState_Ensure()); });
+  });
+  transientThread.join();
+
+  Duration persistent;
+  std::thread persistentThread([&] {
+    {
+      qi::py::GILAcquire lock;
+    }
+    persistent = measure(runs, [] { qi::py::GILAcquire lock; });
+  });
+  persistentThread.join();
+
+  report("GIL acquisition from a native thread (transient thread state)", transient);
+  report("GIL acquisition from a native thread", persistent);
+  reportSpeedup("GIL acquisition from a native thread", transient, persistent);
+}
+
+} // namespace
+
+int main()
+{
+  py::scoped_interpreter interp;
+  py::globals()["qi"] = py::module::import("qi");
+
+  benchmarkHomogeneousListsConversion();
+  benchmarkMapsConversion();
+  benchmarkLargeStringsSerialization();
+  benchmarkNestedGILAcquisitions();
+
+  {
+    qi::py::GILRelease unlock;
+    benchmarkDisownedReferencesStorage();
+    benchmarkNativeThreadGILAcquisition();
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -6,6 +6,7 @@
 #include <qipython/common.hpp>
 #include <qipython/pyguard.hpp>
 #include <gtest/gtest.h>
+#include <thread>
 
 namespace
 {
@@ -48,6 +49,56 @@ TEST(GILAcquire, IsReentrant)
   SUCCEED();
 }
 
+TEST(GILAcquire, NestedInReleaseAcquiresTheGIL)
+{
+  qi::py::GILAcquire acq0; QI_IGNORE_UNUSED(acq0);
+  qi::py::GILAcquire acq1; QI_IGNORE_UNUSED(acq1);
+  {
+    qi::py::GILRelease rel; QI_IGNORE_UNUSED(rel);
+    EXPECT_FALSE(qi::py::gilExistsAndCurrentThreadHoldsIt());
+    {
+      qi::py::GILAcquire acq2; QI_IGNORE_UNUSED(acq2);
+      EXPECT_TRUE(qi::py::gilExistsAndCurrentThreadHoldsIt());
+    }
+    EXPECT_FALSE(qi::py::gilExistsAndCurrentThreadHoldsIt());
+  }
+  EXPECT_TRUE(qi::py::gilExistsAndCurrentThreadHoldsIt());
+}
+
+TEST(GILAcquire, NestedInForeignReleaseAcquiresTheGIL)
+{
+  qi::py::GILAcquire acq0; QI_IGNORE_UNUSED(acq0);
+  {
+    // Releases the GIL as other extensions do, without `GILRelease`.
+    auto* const state = PyEval_SaveThread();
+    EXPECT_FALSE(qi::py::gilExistsAndCurrentThreadHoldsIt());
+    {
+      qi::py::GILAcquire acq1; QI_IGNORE_UNUSED(acq1);
+      EXPECT_TRUE(qi::py::gilExistsAndCurrentThreadHoldsIt());
+    }
+    EXPECT_FALSE(qi::py::gilExistsAndCurrentThreadHoldsIt());
+    PyEval_RestoreThread(state);
+  }
+  EXPECT_TRUE(qi::py::gilExistsAndCurrentThreadHoldsIt());
+}
+
+TEST(GILAcquire, KeepsTheThreadStateOfNativeThreads)
+{
+  qi::py::GILRelease rel; QI_IGNORE_UNUSED(rel);
+  std::thread([] {
+    PyThreadState* threadState = nullptr;
+    {
+      qi::py::GILAcquire acq; QI_IGNORE_UNUSED(acq);
+      threadState = PyThreadState_Get();
+    }
+    EXPECT_EQ(threadState, PyGILState_GetThisThreadState());
+    {
+      qi::py::GILAcquire acq; QI_IGNORE_UNUSED(acq);
+      EXPECT_EQ(threadState, PyThreadState_Get());
+    }
+  }).join();
+}
+
 TEST(GILRelease, IsReentrant)
 {
   qi::py::GILRelease rel0; QI_IGNORE_UNUSED(rel0);
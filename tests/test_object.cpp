@@ -9,12 +9,14 @@
 #include <qipython/pyproperty.hpp>
 #include <qipython/pysignal.hpp>
 #include <qipython/pyfuture.hpp>
+#include <qi/buffer.hpp>
 #include <pybind11/pybind11.h>
 #include <pybind11/embed.h>
 #include <gtest/gtest.h>
 #include <gmock/gmock-matchers.h>
 #include <gmock/gmock.h>
 #include <boost/optional/optional_io.hpp>
+#include <map>
 #include "common.hpp"
 
 namespace py = pybind11;
@@ -105,6 +107,8 @@ struct ToObjectTest : qi::py::test::Execute, testing::Test
   ToObjectTest()
   {
     constexpr const auto declareType = R"py(
+import typing
+
 class Cookies(object):
     def __init__(self, count=1):
         self.count = count
@@ -138,6 +142,22 @@ class Cookies(object):
 
     def unnamed(self):
         return "This function does nothing."
+
+    def weigh(self, grams: int, ratios: typing.Dict[str, float],
+              note: typing.Optional[str] = None) -> typing.List[int]:
+        return [grams] * self.count
+
+    def label(self, name: str, data: bytes, size: typing.Tuple[int, float]) -> None:
+        pass
+
+    def read_label(self, data: bytes) -> str:
+        return data.decode()
+
+    def sweeten(self, sugar: "int | None") -> "float | None":
+        return sugar
+
+    def taste(self, flavor) -> bool:
+        return True
 )py";
     exec(declareType);
   }
@@ -190,6 +210,67 @@ TEST_F(ToObjectTest, MethodWithExplicitSignature)
   EXPECT_EQ(qi::Signature("s"), method.returnSignature());
 }
 
+TEST_F(ToObjectTest, MethodWithoutAnnotationsIsDynamic)
+{
+  auto obj = makeObject();
+  const auto methods = obj.metaObject().findMethod("bake");
+  ASSERT_EQ(1, methods.size());
+
+  const auto method = methods[0];
+  EXPECT_EQ(qi::Signature("(mm)"), method.parametersSignature());
+  EXPECT_EQ(qi::Signature("m"), method.returnSignature());
+}
+
+TEST_F(ToObjectTest, MethodSignatureIsDerivedFromAnnotations)
+{
+  auto obj = makeObject();
+  const auto metaObj = obj.metaObject();
+
+  const auto weighMethods = metaObj.findMethod("weigh");
+  ASSERT_EQ(1, weighMethods.size());
+  EXPECT_EQ(qi::Signature("(l{sd}+s)"), weighMethods[0].parametersSignature());
+  EXPECT_EQ(qi::Signature("[l]"), weighMethods[0].returnSignature());
+
+  const auto labelMethods = metaObj.findMethod("label");
+  ASSERT_EQ(1, labelMethods.size());
+  EXPECT_EQ(qi::Signature("(sr(ld))"), labelMethods[0].parametersSignature());
+  EXPECT_EQ(qi::Signature("v"), labelMethods[0].returnSignature());
+
+  const auto tasteMethods = metaObj.findMethod("taste");
+  ASSERT_EQ(1, tasteMethods.size());
+  EXPECT_EQ(qi::Signature("(m)"), tasteMethods[0].parametersSignature());
+  EXPECT_EQ(qi::Signature("b"), tasteMethods[0].returnSignature());
+}
+
+TEST_F(ToObjectTest, UnionWithNoneAnnotationIsOptional)
+{
+  if (PY_VERSION_HEX < 0x030A0000)
+    GTEST_SKIP() << "Unions written with `|` require Python 3.10.";
+
+  auto obj = makeObject();
+  const auto methods = obj.metaObject().findMethod("sweeten");
+  ASSERT_EQ(1, methods.size());
+  EXPECT_EQ(qi::Signature("(+l)"), methods[0].parametersSignature());
+  EXPECT_EQ(qi::Signature("+d"), methods[0].returnSignature());
+}
+
+TEST_F(ToObjectTest, MethodWithAnnotationsCanBeCalled)
+{
+  auto obj = makeObject(3);
+  const auto res = obj.call<std::vector<int>>("weigh", 200, std::map<std::string, double>{},
+                                              boost::optional<std::string>{});
+  EXPECT_EQ(std::vector<int>(3, 200), res);
+}
+
+TEST_F(ToObjectTest, RawArgumentOfBytesParameterIsBytes)
+{
+  auto obj = makeObject();
+  qi::Buffer data;
+  data.write("chocolate", 9);
+  const auto res = obj.call<std::string>("read_label", data);
+  EXPECT_EQ("chocolate", res);
+}
+
 TEST_F(ToObjectTest, MethodWithExplicitBindForbiddance)
 {
   auto obj = makeObject();
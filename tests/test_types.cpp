@@ -5,10 +5,17 @@
 #include <qi/anyobject.hpp>
 #include <qi/session.hpp>
 #include <qi/jsoncodec.hpp>
+#include <qi/binarycodec.hpp>
+#include <qi/buffer.hpp>
 #include <qipython/pysession.hpp>
 #include <qipython/common.hpp>
 #include <qipython/pyguard.hpp>
+#include <qipython/pytypes.hpp>
+#include <qipython/pyview.hpp>
+#include <qipython/pycodec.hpp>
 #include <boost/thread.hpp>
+#include <limits>
+#include <list>
 #include "common.hpp"
 
 namespace py = pybind11;
@@ -111,6 +118,79 @@ TYPED_TEST(ToAnyValueConversionTest, PyBytes)
   EXPECT_TRUE(v.template to<py::bytes>().equal(py::bytes("donuts")));
 }
 
+struct ToAnyValueBufferConversionTest : qi::py::GILAcquire, testing::Test {};
+
+TEST_F(ToAnyValueBufferConversionTest, BytesDataIsBorrowed)
+{
+  const py::bytes bytes("cupcakes");
+  auto v = bytes.cast<qi::AnyValue>();
+  ASSERT_EQ(qi::TypeKind_String, v.kind());
+
+  const auto itf = static_cast<qi::StringTypeInterface*>(v.type());
+  auto str = itf->get(v.rawValue());
+  EXPECT_EQ(PyBytes_AS_STRING(bytes.ptr()), str.first.first);
+  EXPECT_EQ(8u, str.first.second);
+  if (str.second)
+    str.second(str.first);
+}
+
+TEST_F(ToAnyValueBufferConversionTest, StrUtf8DataIsBorrowed)
+{
+  const py::str str("cr\u00e8me br\u00fbl\u00e9e");
+  auto v = str.cast<qi::AnyValue>();
+  ASSERT_EQ(qi::TypeKind_String, v.kind());
+
+  const auto itf = static_cast<qi::StringTypeInterface*>(v.type());
+  auto data = itf->get(v.rawValue());
+  Py_ssize_t size = 0;
+  EXPECT_EQ(PyUnicode_AsUTF8AndSize(str.ptr(), &size), data.first.first);
+  EXPECT_EQ(static_cast<size_t>(size), data.first.second);
+  EXPECT_EQ("cr\u00e8me br\u00fbl\u00e9e", std::string(data.first.first, data.first.second));
+  if (data.second)
+    data.second(data.first);
+}
+
+TEST_F(ToAnyValueBufferConversionTest, ByteArrayCannotBeResizedWhileDataIsBorrowed)
+{
+  const auto byteArray = py::reinterpret_steal<py::object>(
+    PyByteArray_FromStringAndSize("cookies", 7));
+  auto v = byteArray.cast<qi::AnyValue>();
+  ASSERT_EQ(qi::TypeKind_String, v.kind());
+
+  const auto itf = static_cast<qi::StringTypeInterface*>(v.type());
+  auto str = itf->get(v.rawValue());
+  EXPECT_EQ(PyByteArray_AS_STRING(byteArray.ptr()), str.first.first);
+  EXPECT_EQ(-1, PyByteArray_Resize(byteArray.ptr(), 42));
+  PyErr_Clear();
+
+  str.second(str.first);
+  EXPECT_EQ(0, PyByteArray_Resize(byteArray.ptr(), 42));
+}
+
+TEST_F(ToAnyValueBufferConversionTest, MemoryViewIsRawAndBorrowed)
+{
+  const py::bytes bytes("muffins");
+  const py::memoryview view(bytes);
+  auto v = view.cast<qi::AnyValue>();
+  ASSERT_EQ(qi::TypeKind_Raw, v.kind());
+
+  const auto raw = v.asRaw();
+  EXPECT_EQ(PyBytes_AS_STRING(bytes.ptr()), raw.first);
+  EXPECT_EQ(7u, raw.second);
+}
+
+TEST_F(ToAnyValueBufferConversionTest, RawBufferCannotBeResizedWhileValueLives)
+{
+  const auto array = py::module::import("array").attr("array")("b", py::bytes("scones"));
+  {
+    auto v = array.cast<qi::AnyValue>();
+    ASSERT_EQ(qi::TypeKind_Raw, v.kind());
+    EXPECT_EQ(6u, v.asRaw().second);
+    EXPECT_THROW(array.attr("append")(1), py::error_already_set);
+  }
+  EXPECT_NO_THROW(array.attr("append")(1));
+}
+
 struct ToAnyValueObjectConversionTest : qi::py::GILAcquire, testing::Test {};
 
 TEST_F(ToAnyValueObjectConversionTest, AnyValueFromReturnsDynamic)
@@ -120,6 +200,124 @@ TEST_F(ToAnyValueObjectConversionTest, AnyValueFromReturnsDynamic)
   EXPECT_TRUE(v.template to<py::object>().equal(py::int_(42)));
 }
 
+TEST_F(ToAnyValueObjectConversionTest, RepeatedConversionsOfAnObjectReuseItsValue)
+{
+  py::object obj = py::eval("type('Cookie', (), {})()");
+  const auto ref = qi::py::unwrapAsRef(obj);
+  ASSERT_EQ(qi::TypeKind_Object, ref.kind());
+  EXPECT_EQ(ref.rawValue(), qi::py::unwrapAsRef(obj).rawValue());
+}
+
+TEST_F(ToAnyValueObjectConversionTest, ValueIsKeptWhenItsPybindObjectChanges)
+{
+  py::object obj = py::eval("type('Cookie', (), {})()");
+  const py::object first = obj;
+  const auto firstRef = qi::py::unwrapAsRef(obj);
+
+  obj = py::eval("type('Cake', (), {})()");
+  EXPECT_NE(firstRef.rawValue(), qi::py::unwrapAsRef(obj).rawValue());
+
+  py::object other = first;
+  EXPECT_EQ(firstRef.rawValue(), qi::py::unwrapAsRef(other).rawValue());
+  EXPECT_EQ(qi::TypeKind_Object, firstRef.kind());
+}
+
+TEST_F(ToAnyValueObjectConversionTest, LogLevelIsAnInteger)
+{
+  py::object obj = py::cast(qi::LogLevel_Info);
+  const auto ref = qi::py::unwrapAsRef(obj);
+  ASSERT_EQ(qi::TypeKind_Int, ref.kind());
+  EXPECT_EQ(static_cast<int>(qi::LogLevel_Info), ref.toInt());
+  EXPECT_EQ(ref.rawValue(), qi::py::unwrapAsRef(obj).rawValue());
+
+  obj = py::cast(qi::LogLevel_Error);
+  EXPECT_EQ(static_cast<int>(qi::LogLevel_Error), qi::py::unwrapAsRef(obj).toInt());
+}
+
+struct ToAnyValueSubclassConversionTest : qi::py::GILAcquire, testing::Test
+{
+  ToAnyValueSubclassConversionTest()
+  {
+    py::exec(
+      "import collections\n"
+      "import enum\n"
+      "class Flavor(enum.IntEnum):\n"
+      "    Chocolate = 3\n"
+      "class Label(str): pass\n"
+      "class Weight(float): pass\n"
+      "class Jar(list): pass\n",
+      py::globals(), locals);
+  }
+
+  py::object eval(const char* expr)
+  {
+    return py::eval(expr, py::globals(), locals);
+  }
+
+  py::dict locals;
+};
+
+TEST_F(ToAnyValueSubclassConversionTest, PrimitivesArePrimitives)
+{
+  py::object flavor = eval("Flavor.Chocolate");
+  auto ref = qi::py::unwrapAsRef(flavor);
+  ASSERT_EQ(qi::TypeKind_Int, ref.kind());
+  EXPECT_EQ(3, ref.toInt());
+
+  py::object weight = eval("Weight(2.5)");
+  ref = qi::py::unwrapAsRef(weight);
+  ASSERT_EQ(qi::TypeKind_Float, ref.kind());
+  EXPECT_EQ(2.5, ref.toDouble());
+
+  py::object label = eval("Label('cookie')");
+  ref = qi::py::unwrapAsRef(label);
+  ASSERT_EQ(qi::TypeKind_String, ref.kind());
+  EXPECT_EQ("cookie", ref.toString());
+}
+
+TEST_F(ToAnyValueSubclassConversionTest, ContainersAreContainers)
+{
+  py::object jar = eval("Jar([1, 2, 3])");
+  auto ref = qi::py::unwrapAsRef(jar);
+  ASSERT_EQ(qi::TypeKind_List, ref.kind());
+  EXPECT_EQ(qi::Signature("[l]"), ref.signature());
+  EXPECT_EQ((std::vector<int>{ 1, 2, 3 }), ref.to<std::vector<int>>());
+
+  py::object dict = eval("collections.OrderedDict([('a', 1), ('b', 2)])");
+  ref = qi::py::unwrapAsRef(dict);
+  ASSERT_EQ(qi::TypeKind_Map, ref.kind());
+  EXPECT_EQ(qi::Signature("{sl}"), ref.signature());
+  EXPECT_EQ((std::map<std::string, int>{ { "a", 1 }, { "b", 2 } }),
+            (ref.to<std::map<std::string, int>>()));
+}
+
+TEST_F(ToAnyValueSubclassConversionTest, NumpyScalarsArePrimitives)
+{
+  try
+  {
+    locals["numpy"] = py::module::import("numpy");
+  }
+  catch (const py::error_already_set&)
+  {
+    GTEST_SKIP() << "numpy is not available";
+  }
+
+  py::object integer = eval("numpy.int32(42)");
+  auto ref = qi::py::unwrapAsRef(integer);
+  ASSERT_EQ(qi::TypeKind_Int, ref.kind());
+  EXPECT_EQ(42, ref.toInt());
+
+  py::object floating = eval("numpy.float32(1.5)");
+  ref = qi::py::unwrapAsRef(floating);
+  ASSERT_EQ(qi::TypeKind_Float, ref.kind());
+  EXPECT_EQ(1.5, ref.toDouble());
+
+  py::object boolean = eval("numpy.bool_(True)");
+  ref = qi::py::unwrapAsRef(boolean);
+  ASSERT_EQ(qi::TypeKind_Int, ref.kind());
+  EXPECT_EQ(1, ref.toInt());
+}
+
 // No test with `PybindObjectCast` conversion with `PyObject` as it's equivalent
 // to `PybindObjectCast` conversion with the underlying object which should
 // already be tested.
@@ -156,6 +354,94 @@ TEST_F(ToAnyValueListConversionTest, PybindObjectCastReturnsList)
   EXPECT_EQ(values, toVec(v.asReference()));
 }
 
+TEST_F(ToAnyValueListConversionTest, TraversalsReuseTheSameElements)
+{
+  auto v = list.cast<qi::AnyValue>();
+  const auto first = v.asListValuePtr();
+  const auto second = v.asListValuePtr();
+  ASSERT_EQ(first.size(), second.size());
+  for (std::size_t i = 0; i < first.size(); ++i)
+    EXPECT_EQ(first[i].rawValue(), second[i].rawValue());
+}
+
+TEST_F(ToAnyValueListConversionTest, ReadsTheCurrentElements)
+{
+  auto v = list.cast<qi::AnyValue>();
+  EXPECT_EQ(values, toVec(v.asReference()));
+  list[0] = 42;
+  EXPECT_EQ(42, toVec(v.asReference()).at(0));
+}
+
+TEST_F(ToAnyValueListConversionTest, ReplacedElementsStayValidForTheirReaders)
+{
+  auto v = list.cast<qi::AnyValue>();
+  const auto first = v.asListValuePtr();
+  list[0] = 42;
+  EXPECT_EQ(42, toVec(v.asReference()).at(0));
+  EXPECT_EQ(1, first.at(0).to<int>());
+}
+
+TEST(DisownedReferencesStorageTest, ElementReferencesAreRenewedOnceManyWereReplaced)
+{
+  qi::py::detail::DisownedReferencesStorage storage;
+  int context = 0;
+  const auto first = storage.elementReferences(&context, 1);
+  EXPECT_EQ(first, storage.elementReferences(&context, 1));
+
+  for (int i = 0; i < 100; ++i)
+    first->at(0, [](qi::AnyReference) { return false; },
+              [&] { return qi::AnyValue::from(i).release(); });
+  const auto second = storage.elementReferences(&context, 1);
+  EXPECT_NE(first, second);
+  EXPECT_EQ(0u, second->replacedCount());
+  EXPECT_EQ(99, first->at(0, [](qi::AnyReference) { return true; },
+                          [] { return qi::AnyReference(); }).to<int>());
+  storage.unstore(&context);
+}
+
+TEST_F(ToAnyValueListConversionTest, ElementTypeIsInferredFromElements)
+{
+  EXPECT_EQ(qi::Signature("[l]"), list.cast<qi::AnyValue>().signature());
+  EXPECT_EQ(qi::Signature("[d]"), py::cast(std::vector<double>{ 1.5 }).cast<qi::AnyValue>().signature());
+  EXPECT_EQ(qi::Signature("[s]"), py::cast(std::vector<std::string>{ "a", "b" }).cast<qi::AnyValue>().signature());
+  EXPECT_EQ(qi::Signature("[b]"), py::cast(std::vector<bool>{ true }).cast<qi::AnyValue>().signature());
+}
+
+TEST_F(ToAnyValueListConversionTest, ElementTypeIsDynamicIfElementsDiffer)
+{
+  py::list mixed;
+  mixed.append(1);
+  mixed.append(true);
+  EXPECT_EQ(qi::Signature("[m]"), mixed.cast<qi::AnyValue>().signature());
+  EXPECT_EQ(qi::Signature("[m]"), py::list().cast<qi::AnyValue>().signature());
+}
+
+TEST_F(ToAnyValueListConversionTest, ElementReferencesFollowTheInferredType)
+{
+  const py::list l = py::cast(std::vector<int>{ 1, 2 });
+  auto v = l.cast<qi::AnyValue>();
+  EXPECT_EQ(qi::TypeKind_Int, (*v.begin()).kind());
+
+  l.append("three");
+  v = l.cast<qi::AnyValue>();
+  EXPECT_EQ(qi::TypeKind_Dynamic, (*v.begin()).kind());
+}
+
+TEST_F(ToAnyValueListConversionTest, ElementsOfAnotherTypeAddedAfterConversionAreDynamic)
+{
+  const py::list l = py::cast(std::vector<int>{ 1, 2 });
+  const auto v = l.cast<qi::AnyValue>();
+  ASSERT_EQ(qi::Signature("[l]"), v.signature());
+
+  l.append("three");
+  l[0] = py::none();
+  EXPECT_EQ(qi::TypeKind_Dynamic, (*v.begin()).kind());
+  const auto elements = v.to<std::vector<qi::AnyValue>>();
+  ASSERT_EQ(3u, elements.size());
+  EXPECT_EQ(2, elements[1].to<int>());
+  EXPECT_EQ("three", elements[2].to<std::string>());
+}
+
 using DictTypes = testing::Types<py::dict, py::kwargs>;
 template<typename Dict>
 struct ToAnyValueDictConversionTest : qi::py::GILAcquire, testing::Test
@@ -197,6 +483,90 @@ TYPED_TEST(ToAnyValueDictConversionTest, PybindObjectCastReturnsMap)
   EXPECT_EQ(this->values, this->toMap(v.asReference()));
 }
 
+struct ToAnyValueDictIterationTest : qi::py::GILAcquire, testing::Test {};
+
+TEST_F(ToAnyValueDictIterationTest, TraversesElementsInDictionaryOrder)
+{
+  py::dict dict;
+  for (int i = 0; i < 1000; ++i)
+    dict[py::int_(i * 7 % 1000)] = i;
+  const auto expected = py::list(dict.attr("keys")()).cast<std::vector<int>>();
+
+  const auto v = dict.cast<qi::AnyValue>();
+  std::vector<int> keys;
+  const auto end = v.end();
+  for (auto it = v.begin(); it != end; ++it)
+    keys.push_back((*it)[0].to<int>());
+  EXPECT_EQ(expected, keys);
+}
+
+TEST_F(ToAnyValueDictIterationTest, TraversalsReuseTheSamePairs)
+{
+  py::dict dict;
+  dict["one"] = 1;
+  dict["two"] = 2;
+  const auto v = dict.cast<qi::AnyValue>();
+
+  const auto firstPair = (*v.begin()).rawValue();
+  EXPECT_EQ(firstPair, (*v.begin()).rawValue());
+
+  dict["one"] = 11;
+  EXPECT_EQ(11, (*v.begin())[1].to<int>());
+}
+
+TEST_F(ToAnyValueDictIterationTest, LookupsOfAKeyReuseTheSameElement)
+{
+  py::dict dict;
+  dict["one"] = 1;
+  auto v = dict.cast<qi::AnyValue>();
+
+  const auto first = v["one"];
+  EXPECT_EQ(first.rawValue(), v["one"].rawValue());
+
+  dict["one"] = 11;
+  EXPECT_EQ(11, v["one"].to<int>());
+  EXPECT_EQ(1, first.to<int>());
+}
+
+TEST_F(ToAnyValueDictIterationTest, KeyAndElementTypesAreInferred)
+{
+  py::dict dict;
+  dict["one"] = 1.;
+  dict["two"] = 2.;
+  EXPECT_EQ(qi::Signature("{sd}"), dict.cast<qi::AnyValue>().signature());
+  EXPECT_EQ(2., dict.cast<qi::AnyValue>().to<std::map<std::string, double>>().at("two"));
+
+  dict["three"] = py::none();
+  EXPECT_EQ(qi::Signature("{sm}"), dict.cast<qi::AnyValue>().signature());
+}
+
+TEST_F(ToAnyValueDictIterationTest, ElementsOfAnotherTypeAddedAfterConversionAreDynamic)
+{
+  py::dict dict;
+  dict["one"] = 1.;
+  auto v = dict.cast<qi::AnyValue>();
+  ASSERT_EQ(qi::Signature("{sd}"), v.signature());
+
+  // The lookup of a missing key inserts `None`.
+  EXPECT_EQ(qi::TypeKind_Dynamic, v["two"].kind());
+  dict["one"] = "one";
+  EXPECT_EQ("one", v["one"].to<std::string>());
+  dict[py::int_(3)] = 3.;
+  EXPECT_EQ(3u, v.to<std::map<qi::AnyValue, qi::AnyValue>>().size());
+}
+
+TEST_F(ToAnyValueDictIterationTest, ThrowsIfDictionaryChangesSize)
+{
+  py::dict dict;
+  dict["one"] = 1;
+  dict["two"] = 2;
+  const auto v = dict.cast<qi::AnyValue>();
+
+  auto it = v.begin();
+  dict["three"] = 3;
+  EXPECT_ANY_THROW(*it);
+}
+
 using TupleTypes = testing::Types<py::tuple, py::args>;
 template <typename Tuple>
 struct ToAnyValueTupleConversionTest : qi::py::GILAcquire, testing::Test
@@ -233,6 +603,674 @@ TYPED_TEST(ToAnyValueTupleConversionTest, PybindObjectCastReturnsTuple)
   EXPECT_EQ(this->values, this->toTuple(v.asReference()));
 }
 
+struct FromStringConversionTest : qi::py::GILAcquire, testing::Test
+{
+  static py::object toPyObject(const std::string& str)
+  {
+    return qi::py::unwrapValue(qi::AnyReference::from(str));
+  }
+};
+
+TEST_F(FromStringConversionTest, AsciiStringIsCompactStr)
+{
+  const std::string str = "chocolate chip cookies with a long enough name";
+  const auto obj = toPyObject(str);
+  ASSERT_TRUE(PyUnicode_CheckExact(obj.ptr()));
+  EXPECT_EQ(PyUnicode_1BYTE_KIND, PyUnicode_KIND(obj.ptr()));
+  EXPECT_EQ(127, PyUnicode_MAX_CHAR_VALUE(obj.ptr()));
+  EXPECT_EQ(str, obj.cast<std::string>());
+}
+
+TEST_F(FromStringConversionTest, Utf8StringIsStr)
+{
+  for (const std::string str : { "cr\xc3\xa8me br\xc3\xbbl\xc3\xa9" "e",
+                                 "\xe2\x82\xac", "\xf0\x9f\x8d\xaa", "\xef\xbf\xbf",
+                                 "\xf4\x8f\xbf\xbf" })
+  {
+    const auto obj = toPyObject(str);
+    ASSERT_TRUE(PyUnicode_CheckExact(obj.ptr())) << str;
+    EXPECT_EQ(str, obj.cast<std::string>());
+  }
+}
+
+TEST_F(FromStringConversionTest, InvalidUtf8StringIsBytes)
+{
+  // Unexpected continuation, overlong forms, a surrogate, a code point above
+  // U+10FFFF and truncated sequences.
+  for (const std::string str : { "cookie\x80", "\xc0\xaf", "\xe0\x80\xaf",
+                                 "\xed\xa0\x80", "\xf4\x90\x80\x80",
+                                 "\xe2\x82", "muffin\xf0\x9f\x8d" })
+  {
+    const auto obj = toPyObject(str);
+    ASSERT_TRUE(PyBytes_CheckExact(obj.ptr())) << str;
+    EXPECT_EQ(str, obj.cast<std::string>());
+  }
+}
+
+struct FromMapConversionTest : qi::py::GILAcquire, testing::Test
+{
+  static py::object keyOf(const std::map<std::string, int>& map)
+  {
+    const auto obj = qi::py::unwrapValue(qi::AnyReference::from(map));
+    const py::dict dict(obj);
+    EXPECT_EQ(1u, dict.size());
+    return py::reinterpret_borrow<py::object>(dict.begin()->first);
+  }
+};
+
+TEST_F(FromMapConversionTest, StringKeysAreInternedAndReused)
+{
+  const auto key = keyOf({ { "cookies", 1 } });
+  ASSERT_TRUE(PyUnicode_CheckExact(key.ptr()));
+  EXPECT_TRUE(PyUnicode_CHECK_INTERNED(key.ptr()));
+  EXPECT_TRUE(keyOf({ { "cookies", 2 } }).is(key));
+}
+
+TEST_F(FromMapConversionTest, MapOfValuesIsDict)
+{
+  const std::map<std::string, qi::AnyValue> values = {
+    { "cookies", qi::AnyValue::from(42) },
+    { "muffins", qi::AnyValue::from(std::string("chocolate")) },
+  };
+  const auto obj = qi::py::unwrapValue(qi::AnyReference::from(values));
+  ASSERT_TRUE(PyDict_CheckExact(obj.ptr()));
+  const py::dict dict(obj);
+  ASSERT_EQ(2u, dict.size());
+  EXPECT_EQ(42, dict["cookies"].cast<int>());
+  EXPECT_EQ("chocolate", dict["muffins"].cast<std::string>());
+}
+
+TEST_F(FromMapConversionTest, LongStringKeysAreNotReused)
+{
+  const std::string longKey(1024, 'c');
+  const auto key = keyOf({ { longKey, 1 } });
+  EXPECT_EQ(longKey, key.cast<std::string>());
+  EXPECT_FALSE(keyOf({ { longKey, 2 } }).is(key));
+}
+
+struct FromContainerToViewConversionTest : qi::py::GILAcquire, testing::Test
+{
+  static py::object viewType(const char* name)
+  {
+    return py::module::import("qi").attr(name);
+  }
+
+  qi::py::LazyContainerViewsScope lazy{ true };
+};
+
+TEST_F(FromContainerToViewConversionTest, ListIsListView)
+{
+  const std::vector<int> values = { 1, 2, 3 };
+  const auto obj = qi::py::unwrapValue(qi::AnyReference::from(values));
+  ASSERT_TRUE(py::isinstance(obj, viewType("ListView")));
+  EXPECT_EQ(3u, py::len(obj));
+  EXPECT_EQ(2, obj[py::int_(1)].cast<int>());
+  EXPECT_EQ(3, obj[py::int_(-1)].cast<int>());
+
+  std::vector<int> iterated;
+  for (const auto element : obj)
+    iterated.push_back(element.cast<int>());
+  EXPECT_EQ(values, iterated);
+
+  const auto list = obj.attr("materialize")();
+  ASSERT_TRUE(PyList_CheckExact(list.ptr()));
+  EXPECT_EQ(values, list.cast<std::vector<int>>());
+}
+
+TEST_F(FromContainerToViewConversionTest, ElementsOfListWithoutRandomAccessAreIndexed)
+{
+  const std::list<int> values = { 1, 2, 3 };
+  const auto obj = qi::py::unwrapValue(qi::AnyReference::from(values));
+  ASSERT_TRUE(py::isinstance(obj, viewType("ListView")));
+  EXPECT_EQ(2, obj[py::int_(1)].cast<int>());
+  EXPECT_EQ(3, obj[py::int_(-1)].cast<int>());
+  EXPECT_EQ((std::vector<int>{ 1, 3 }),
+            obj[py::slice(0, 3, 2)].cast<std::vector<int>>());
+}
+
+TEST_F(FromContainerToViewConversionTest, OwnedValueIsSharedByItsView)
+{
+  auto value = qi::AnyValue::from(std::vector<int>{ 1, 2, 3 });
+  const auto storage = value.rawValue();
+  const auto obj = qi::py::unwrapValue(std::move(value));
+  ASSERT_TRUE(py::isinstance(obj, viewType("ListView")));
+  EXPECT_EQ(storage, qi::py::viewedContainer(obj)->rawValue());
+  EXPECT_EQ(3, obj[py::int_(2)].cast<int>());
+}
+
+TEST_F(FromContainerToViewConversionTest, NestedContainersAreViews)
+{
+  const std::map<std::string, std::vector<int>> values = { { "cookies", { 1, 2 } },
+                                                           { "muffins", { 3 } } };
+  const auto obj = qi::py::unwrapValue(qi::AnyReference::from(values));
+  ASSERT_TRUE(py::isinstance(obj, viewType("MapView")));
+  EXPECT_TRUE(obj.contains("cookies"));
+  EXPECT_FALSE(obj.contains("donuts"));
+
+  const py::object cookies = obj[py::str("cookies")];
+  ASSERT_TRUE(py::isinstance(cookies, viewType("ListView")));
+  EXPECT_EQ(2, cookies[py::int_(1)].cast<int>());
+
+  const auto dict = obj.attr("materialize")();
+  ASSERT_TRUE(PyDict_CheckExact(dict.ptr()));
+  EXPECT_EQ(values, (dict.cast<std::map<std::string, std::vector<int>>>()));
+}
+
+TEST_F(FromContainerToViewConversionTest, ViewIsNotConvertedAgain)
+{
+  const std::vector<double> values = { 1.5, 2.5 };
+  py::object obj = qi::py::unwrapValue(qi::AnyReference::from(values));
+  const auto ref = qi::py::unwrapAsRef(obj);
+  EXPECT_EQ(qi::typeOf<std::vector<double>>()->info(), ref.type()->info());
+  EXPECT_EQ(values, ref.to<std::vector<double>>());
+}
+
+TEST_F(FromContainerToViewConversionTest, DisabledConversionReturnsList)
+{
+  qi::py::LazyContainerViewsScope eager(false);
+  const auto obj = qi::py::unwrapValue(qi::AnyReference::from(std::vector<int>{ 1 }));
+  EXPECT_TRUE(PyList_CheckExact(obj.ptr()));
+}
+
+struct FromHomogeneousListConversionTest : qi::py::GILAcquire, testing::Test {};
+
+TEST_F(FromHomogeneousListConversionTest, VectorOfDoubles)
+{
+  const std::vector<double> values = { 1.5, -2.25, 0. };
+  const auto obj = qi::py::unwrapValue(qi::AnyReference::from(values));
+  ASSERT_TRUE(PyList_CheckExact(obj.ptr()));
+  EXPECT_EQ(values, obj.cast<std::vector<double>>());
+}
+
+TEST_F(FromHomogeneousListConversionTest, VectorOfUnsignedIntegers)
+{
+  const std::vector<std::uint64_t> values = { 0, 42, std::numeric_limits<std::uint64_t>::max() };
+  const auto obj = qi::py::unwrapValue(qi::AnyReference::from(values));
+  ASSERT_TRUE(PyList_CheckExact(obj.ptr()));
+  EXPECT_EQ(values, obj.cast<std::vector<std::uint64_t>>());
+}
+
+TEST_F(FromHomogeneousListConversionTest, VectorOfStrings)
+{
+  const std::vector<std::string> values = { "cookies", "", "muffins" };
+  const auto obj = qi::py::unwrapValue(qi::AnyReference::from(values));
+  ASSERT_TRUE(PyList_CheckExact(obj.ptr()));
+  for (const auto& item : py::list(obj))
+    EXPECT_TRUE(PyUnicode_CheckExact(item.ptr()));
+  EXPECT_EQ(values, obj.cast<std::vector<std::string>>());
+}
+
+TEST_F(FromHomogeneousListConversionTest, InvalidUtf8StringsAreBytes)
+{
+  const std::vector<std::string> values = { "\xff\xfe" };
+  const auto obj = qi::py::unwrapValue(qi::AnyReference::from(values));
+  const py::list list(obj);
+  ASSERT_EQ(1u, list.size());
+  EXPECT_TRUE(PyBytes_CheckExact(list[0].ptr()));
+}
+
+TEST_F(FromHomogeneousListConversionTest, VectorOfBooleans)
+{
+  const std::vector<bool> values = { true, false };
+  const auto obj = qi::py::unwrapValue(qi::AnyReference::from(values));
+  const py::list list(obj);
+  ASSERT_EQ(2u, list.size());
+  EXPECT_TRUE(list[0].is(py::bool_(true)));
+  EXPECT_TRUE(list[1].is(py::bool_(false)));
+}
+
+TEST_F(FromHomogeneousListConversionTest, ListOfSmallIntegers)
+{
+  const std::list<std::int8_t> values = { -1, 2, 3 };
+  const auto obj = qi::py::unwrapValue(qi::AnyReference::from(values));
+  EXPECT_EQ((std::vector<int>{ -1, 2, 3 }), obj.cast<std::vector<int>>());
+}
+
+struct FromStructListToColumnsConversionTest : qi::py::GILAcquire, testing::Test {};
+
+TEST_F(FromStructListToColumnsConversionTest, IsDisabledByDefault)
+{
+  EXPECT_FALSE(qi::py::columnarConversionEnabled());
+  const std::vector<std::pair<double, std::int32_t>> values{ { 0.5, 1 }, { 1.5, 2 } };
+  const auto obj = qi::py::unwrapValue(qi::AnyReference::from(values));
+  EXPECT_TRUE(PyList_CheckExact(obj.ptr()));
+}
+
+TEST_F(FromStructListToColumnsConversionTest, MembersAreColumns)
+{
+  const std::vector<std::pair<double, std::int32_t>> values{ { 0.5, 1 }, { 1.5, 2 } };
+  py::object obj;
+  {
+    qi::py::ColumnarConversionScope scope(true);
+    obj = qi::py::unwrapValue(qi::AnyReference::from(values));
+  }
+  ASSERT_TRUE(PyDict_CheckExact(obj.ptr()));
+  ASSERT_EQ(2u, py::len(obj));
+
+  const auto array = py::module::import("array").attr("array");
+  const py::object doubles = obj[py::int_(0)];
+  ASSERT_TRUE(py::isinstance(doubles, array));
+  EXPECT_EQ("d", doubles.attr("typecode").cast<std::string>());
+  EXPECT_EQ((std::vector<double>{ 0.5, 1.5 }), doubles.attr("tolist")().cast<std::vector<double>>());
+
+  const py::object integers = obj[py::int_(1)];
+  ASSERT_TRUE(py::isinstance(integers, array));
+  EXPECT_EQ("i", integers.attr("typecode").cast<std::string>());
+  EXPECT_EQ((std::vector<int>{ 1, 2 }), integers.attr("tolist")().cast<std::vector<int>>());
+}
+
+TEST_F(FromStructListToColumnsConversionTest, OtherMembersAreLists)
+{
+  const std::vector<std::pair<std::string, bool>> values{ { "cookie", true }, { "muffin", false } };
+  qi::py::ColumnarConversionScope scope(true);
+  const auto obj = qi::py::unwrapValue(qi::AnyReference::from(values));
+  ASSERT_TRUE(PyDict_CheckExact(obj.ptr()));
+
+  const py::object strings = obj[py::int_(0)];
+  ASSERT_TRUE(PyList_CheckExact(strings.ptr()));
+  EXPECT_EQ((std::vector<std::string>{ "cookie", "muffin" }), strings.cast<std::vector<std::string>>());
+
+  const py::object booleans = obj[py::int_(1)];
+  ASSERT_TRUE(PyList_CheckExact(booleans.ptr()));
+  EXPECT_TRUE(booleans.equal(py::eval("[True, False]")));
+}
+
+struct ToAnyValueNumericBufferConversionTest : qi::py::GILAcquire, testing::Test
+{
+  static py::object makeArray(const char* typeCode, py::list values)
+  {
+    return py::module::import("array").attr("array")(typeCode, values);
+  }
+};
+
+TEST_F(ToAnyValueNumericBufferConversionTest, ArrayOfDoublesIsAListOfDoubles)
+{
+  const auto array = makeArray("d", py::cast(std::vector<double>{ 1.5, -2.25, 4. }));
+  const auto v = array.cast<qi::AnyValue>();
+  ASSERT_EQ(qi::TypeKind_List, v.kind());
+  EXPECT_EQ(qi::typeOf<double>(), static_cast<qi::ListTypeInterface*>(v.type())->elementType());
+  EXPECT_EQ((std::vector<double>{ 1.5, -2.25, 4. }), v.to<std::vector<double>>());
+}
+
+TEST_F(ToAnyValueNumericBufferConversionTest, ArrayOfShortsIsAListOfIntegers)
+{
+  const auto array = makeArray("h", py::cast(std::vector<int>{ -3, 0, 7 }));
+  const auto v = array.cast<qi::AnyValue>();
+  ASSERT_EQ(qi::TypeKind_List, v.kind());
+  EXPECT_EQ((std::vector<int>{ -3, 0, 7 }), v.to<std::vector<int>>());
+}
+
+TEST_F(ToAnyValueNumericBufferConversionTest, ArrayCannotBeResizedWhileIterated)
+{
+  const auto array = makeArray("d", py::cast(std::vector<double>{ 1.5, -2.25 }));
+  {
+    const auto v = array.cast<qi::AnyValue>();
+    auto it = v.begin();
+    EXPECT_THROW(array.attr("append")(4.), py::error_already_set);
+
+    std::vector<double> values;
+    for (const auto end = v.end(); it != end; ++it)
+      values.push_back((*it).to<double>());
+    EXPECT_EQ((std::vector<double>{ 1.5, -2.25 }), values);
+  }
+  EXPECT_NO_THROW(array.attr("append")(4.));
+}
+
+TEST_F(ToAnyValueNumericBufferConversionTest, ArrayOfBytesIsRaw)
+{
+  const auto array = makeArray("B", py::cast(std::vector<int>{ 1, 2, 3 }));
+  const auto v = array.cast<qi::AnyValue>();
+  EXPECT_EQ(qi::TypeKind_Raw, v.kind());
+}
+
+struct FromNumericListToNumpyArrayConversionTest : qi::py::GILAcquire, testing::Test
+{
+  void SetUp() override
+  {
+    try
+    {
+      numpy = py::module::import("numpy");
+    }
+    catch (const py::error_already_set&)
+    {
+      GTEST_SKIP() << "numpy is not available";
+    }
+  }
+
+  py::object numpy;
+};
+
+TEST_F(FromNumericListToNumpyArrayConversionTest, IsDisabledByDefault)
+{
+  EXPECT_FALSE(qi::py::numpyArrayConversionEnabled());
+  const auto obj = qi::py::unwrapValue(qi::AnyReference::from(std::vector<double>{ 1., 2. }));
+  EXPECT_TRUE(PyList_CheckExact(obj.ptr()));
+}
+
+TEST_F(FromNumericListToNumpyArrayConversionTest, ConvertsVectorsInScope)
+{
+  const std::vector<float> values = { 1.5f, 2.5f, -1.f };
+  py::object obj;
+  {
+    qi::py::NumpyArrayConversionScope scope(true);
+    obj = qi::py::unwrapValue(qi::AnyReference::from(values));
+  }
+  ASSERT_TRUE(py::isinstance(obj, numpy.attr("ndarray")));
+  EXPECT_EQ("float32", py::str(obj.attr("dtype")).cast<std::string>());
+  EXPECT_EQ(values, obj.attr("tolist")().cast<std::vector<float>>());
+  EXPECT_FALSE(qi::py::numpyArrayConversionEnabled());
+}
+
+TEST_F(FromNumericListToNumpyArrayConversionTest, ArraysAreConvertedBackToLists)
+{
+  const auto array = numpy.attr("arange")(5, py::arg("dtype") = "int64");
+  const auto v = array.cast<qi::AnyValue>();
+  ASSERT_EQ(qi::TypeKind_List, v.kind());
+  EXPECT_EQ((std::vector<std::int64_t>{ 0, 1, 2, 3, 4 }), v.to<std::vector<std::int64_t>>());
+}
+
+struct ConversionPlanTest : qi::py::GILAcquire, testing::Test
+{
+  const std::shared_ptr<const qi::py::ConversionPlan> plan =
+    qi::py::ConversionPlan::of(qi::Signature("(iLdsm)"), qi::Signature("f"));
+};
+
+TEST_F(ConversionPlanTest, IsSharedBetweenSameSignatures)
+{
+  EXPECT_EQ(plan, qi::py::ConversionPlan::of(qi::Signature("(iLdsm)"), qi::Signature("f")));
+  EXPECT_NE(plan, qi::py::ConversionPlan::of(qi::Signature("(iLdsm)"), qi::Signature("d")));
+  EXPECT_EQ(5u, plan->parameterCount());
+}
+
+TEST_F(ConversionPlanTest, ConvertsObjectsToTheTypesOfTheParameters)
+{
+  const auto i = plan->parameterFromPyObject(0, py::int_(-42));
+  EXPECT_EQ(qi::typeOf<std::int32_t>(), i.type());
+  EXPECT_EQ(-42, i.to<int>());
+
+  const auto l = plan->parameterFromPyObject(1, py::int_(42));
+  EXPECT_EQ(qi::typeOf<std::uint64_t>(), l.type());
+  EXPECT_EQ(42u, l.to<std::uint64_t>());
+
+  const auto d = plan->parameterFromPyObject(2, py::float_(1.5));
+  EXPECT_EQ(qi::typeOf<double>(), d.type());
+  EXPECT_EQ(1.5, d.to<double>());
+
+  EXPECT_EQ("cookies", plan->parameterFromPyObject(3, py::str("cookies")).toString());
+  EXPECT_EQ(qi::TypeKind_List,
+            plan->parameterFromPyObject(4, py::list()).kind());
+}
+
+TEST_F(ConversionPlanTest, FallsBackToGenericConversionForUnexpectedObjects)
+{
+  const auto outOfRange = plan->parameterFromPyObject(0, py::int_(1ll << 40));
+  EXPECT_NE(qi::typeOf<std::int32_t>(), outOfRange.type());
+  EXPECT_EQ(1ll << 40, outOfRange.to<long long>());
+
+  const auto str = plan->parameterFromPyObject(2, py::str("muffins"));
+  EXPECT_EQ(qi::TypeKind_String, str.kind());
+}
+
+TEST_F(ConversionPlanTest, ConvertsValuesToPythonObjects)
+{
+  EXPECT_EQ(42, plan->parameterToPyObject(0, qi::AnyReference::from(42)).cast<int>());
+  EXPECT_EQ("cookies", plan->parameterToPyObject(3, qi::AnyReference::from(std::string("cookies")))
+                         .cast<std::string>());
+  EXPECT_EQ(2.5f, plan->resultToPyObject(qi::AnyReference::from(2.5f)).cast<float>());
+
+  // Values of unexpected types are converted generically.
+  const auto list = plan->parameterToPyObject(0, qi::AnyReference::from(std::vector<int>{ 1, 2 }));
+  EXPECT_EQ((std::vector<int>{ 1, 2 }), list.cast<std::vector<int>>());
+}
+
+struct FromRawConversionTest : qi::py::GILAcquire, testing::Test
+{
+  FromRawConversionTest()
+  {
+    buffer.write(data.data(), data.size());
+  }
+
+  const std::string data = "cookies";
+  qi::Buffer buffer;
+};
+
+TEST_F(FromRawConversionTest, ReturnsReadOnlyMemoryViewOnBufferData)
+{
+  const auto obj = qi::py::unwrapValue(qi::AnyReference::from(buffer));
+  ASSERT_TRUE(PyMemoryView_Check(obj.ptr()));
+
+  const auto view = PyMemoryView_GET_BUFFER(obj.ptr());
+  EXPECT_TRUE(view->readonly);
+  EXPECT_EQ(buffer.data(), view->buf);
+  EXPECT_EQ(data, py::bytes(obj.attr("tobytes")()).cast<std::string>());
+}
+
+TEST_F(FromRawConversionTest, ViewOutlivesSourceBuffer)
+{
+  py::object obj;
+  {
+    qi::Buffer tmp;
+    tmp.write(data.data(), data.size());
+    obj = qi::py::unwrapValue(qi::AnyReference::from(tmp));
+  }
+  EXPECT_EQ(data, py::bytes(obj.attr("tobytes")()).cast<std::string>());
+}
+
+TEST_F(FromRawConversionTest, SubBuffersAreNestedViews)
+{
+  const std::string subData = "muffins";
+  qi::Buffer subBuffer;
+  subBuffer.write(subData.data(), subData.size());
+  const auto offset = buffer.addSubBuffer(subBuffer);
+
+  const auto obj = qi::py::unwrapValue(qi::AnyReference::from(buffer));
+  const py::list subBuffers = obj.attr("obj").attr("subBuffers")();
+  ASSERT_EQ(1u, subBuffers.size());
+
+  const py::tuple offsetAndView = subBuffers[0];
+  EXPECT_EQ(offset, offsetAndView[0].cast<std::size_t>());
+  const py::object subView = offsetAndView[1];
+  ASSERT_TRUE(PyMemoryView_Check(subView.ptr()));
+  EXPECT_EQ(subData, py::bytes(subView.attr("tobytes")()).cast<std::string>());
+}
+
+struct ToAnyValueStructConversionTest : qi::py::GILAcquire, testing::Test {};
+
+TEST_F(ToAnyValueStructConversionTest, MemberReferencesAreReused)
+{
+  const py::tuple tuple = py::make_tuple(1, "two", 3.0);
+  auto v = tuple.cast<qi::AnyValue>();
+  ASSERT_EQ(qi::TypeKind_Tuple, v.kind());
+
+  const auto members = v.asTupleValuePtr();
+  ASSERT_EQ(3u, members.size());
+  for (std::size_t i = 0; i < members.size(); ++i)
+    EXPECT_TRUE(members[i].to<py::object>().is(tuple[i]));
+
+  const auto itf = static_cast<qi::StructTypeInterface*>(v.type());
+  EXPECT_TRUE(itf->get(v.rawValue(), 2) == members[2].rawValue());
+}
+
+TEST_F(ToAnyValueStructConversionTest, TuplesOfTheSameSizeShareTheirType)
+{
+  for (const std::size_t size : { 0, 1, 31, 32, 33, 100, 5000 })
+  {
+    const py::tuple first(size);
+    const py::tuple second(size);
+    for (std::size_t i = 0; i < size; ++i)
+    {
+      first[i] = py::int_(i);
+      second[i] = py::str("value");
+    }
+
+    const auto firstValue = first.cast<qi::AnyValue>();
+    const auto secondValue = second.cast<qi::AnyValue>();
+    EXPECT_EQ(firstValue.type(), secondValue.type());
+    EXPECT_EQ(size, firstValue.asTupleValuePtr().size());
+  }
+}
+
+TEST_F(ToAnyValueStructConversionTest, SetItemsAreAllAccessible)
+{
+  const py::set set = py::cast(std::set<int>{ 1, 2, 3 });
+  auto v = set.cast<qi::AnyValue>();
+  ASSERT_EQ(qi::TypeKind_Tuple, v.kind());
+
+  std::set<int> values;
+  for (const auto& member : v.asTupleValuePtr())
+    values.insert(member.to<int>());
+  EXPECT_EQ((std::set<int>{ 1, 2, 3 }), values);
+}
+
+TEST_F(ToAnyValueStructConversionTest, MembersFollowTheObjectOfTheStorage)
+{
+  py::object obj = py::make_tuple(1, 2);
+  EXPECT_EQ(1, qi::py::unwrapAsRef(obj).asTupleValuePtr().at(0).to<int>());
+
+  obj = py::make_tuple(3, 4);
+  EXPECT_EQ(3, qi::py::unwrapAsRef(obj).asTupleValuePtr().at(0).to<int>());
+}
+
+TEST_F(ToAnyValueStructConversionTest, SetIsReadAgainByEachTraversal)
+{
+  py::set set;
+  set.add(1);
+  set.add(2);
+  auto v = set.cast<qi::AnyValue>();
+  ASSERT_EQ(qi::TypeKind_Tuple, v.kind());
+
+  const auto membersOf = [&] {
+    std::set<int> values;
+    for (const auto& member : v.asTupleValuePtr())
+      values.insert(member.to<int>());
+    return values;
+  };
+  EXPECT_EQ((std::set<int>{ 1, 2 }), membersOf());
+
+  set.attr("discard")(1);
+  set.add(3);
+  EXPECT_EQ((std::set<int>{ 2, 3 }), membersOf());
+
+  set.add(4);
+  EXPECT_THROW(membersOf(), std::runtime_error);
+}
+
+TEST_F(ToAnyValueStructConversionTest, TupleItemsAreCopiedOnce)
+{
+  const py::tuple tuple = py::make_tuple(1, 2);
+  auto v = tuple.cast<qi::AnyValue>();
+  ASSERT_EQ(qi::TypeKind_Tuple, v.kind());
+
+  const auto itf = static_cast<qi::StructTypeInterface*>(v.type());
+  const auto first = itf->get(v.rawValue(), 0);
+  EXPECT_EQ(first, itf->get(v.rawValue(), 0));
+  EXPECT_EQ(first, itf->get(v.rawValue()).at(0));
+  EXPECT_EQ(1, tuple[0].cast<int>());
+}
+
+struct StructClassConversionTest : qi::py::GILAcquire, testing::Test
+{
+  StructClassConversionTest()
+  {
+    py::exec(
+      "import dataclasses\n"
+      "import typing\n"
+      "@dataclasses.dataclass\n"
+      "class Cookie:\n"
+      "    weight: float\n"
+      "    count: int\n"
+      "    label: str\n"
+      "    toppings: list\n"
+      "class Muffin(typing.NamedTuple):\n"
+      "    flavor: str\n"
+      "    size: int\n"
+      "@dataclasses.dataclass\n"
+      "class Tart:\n"
+      "    filling: 'Undefined'\n"
+      "    size: int\n",
+      py::globals(), locals);
+    qi::py::registerStructClass(locals["Cookie"], "Cookie");
+    qi::py::registerStructClass(locals["Muffin"], "Muffin");
+    qi::py::registerStructClass(locals["Tart"], "Tart");
+  }
+
+  py::dict locals;
+};
+
+TEST_F(StructClassConversionTest, DataclassInstanceIsStruct)
+{
+  py::object cookie = py::eval("Cookie(2.5, 3, 'chocolate', ['nuts'])", py::globals(), locals);
+  const auto ref = qi::py::unwrapAsRef(cookie);
+  ASSERT_EQ(qi::TypeKind_Tuple, ref.kind());
+  EXPECT_EQ(qi::Signature("(dlsm)<Cookie,weight,count,label,toppings>"), ref.signature());
+
+  const auto members = ref.asTupleValuePtr();
+  ASSERT_EQ(4u, members.size());
+  EXPECT_EQ(2.5, members[0].toDouble());
+  EXPECT_EQ(3, members[1].toInt());
+  EXPECT_EQ("chocolate", members[2].toString());
+}
+
+TEST_F(StructClassConversionTest, NamedTupleInstanceIsStruct)
+{
+  py::object muffin = py::eval("Muffin('blueberry', 2)", py::globals(), locals);
+  const auto ref = qi::py::unwrapAsRef(muffin);
+  ASSERT_EQ(qi::TypeKind_Tuple, ref.kind());
+  EXPECT_EQ(qi::Signature("(sl)<Muffin,flavor,size>"), ref.signature());
+  EXPECT_EQ("blueberry", ref.asTupleValuePtr()[0].toString());
+}
+
+TEST_F(StructClassConversionTest, UnresolvedHintsMakeDynamicFields)
+{
+  py::object tart = py::eval("Tart('apple', 3)", py::globals(), locals);
+  const auto ref = qi::py::unwrapAsRef(tart);
+  ASSERT_EQ(qi::TypeKind_Tuple, ref.kind());
+  EXPECT_EQ(qi::Signature("(mm)<Tart,filling,size>"), ref.signature());
+}
+
+TEST_F(StructClassConversionTest, StructIsInstanceOfItsClass)
+{
+  for (const char* expr : { "Cookie(2.5, 3, 'chocolate', ['nuts'])", "Muffin('blueberry', 2)" })
+  {
+    py::object obj = py::eval(expr, py::globals(), locals);
+    const qi::AnyValue value(qi::py::unwrapAsRef(obj));
+    const auto res = qi::py::unwrapValue(value.asReference());
+    EXPECT_TRUE(res.get_type().is(obj.get_type())) << expr;
+    EXPECT_TRUE(res.equal(obj)) << expr;
+  }
+}
+
+struct BinaryCodecTest : qi::py::GILAcquire, testing::Test {};
+
+TEST_F(BinaryCodecTest, EncodesAsLibqi)
+{
+  const std::vector<std::int32_t> values{ 1, 2, 3 };
+  qi::Buffer expected;
+  qi::encodeBinary(&expected, qi::AnyReference::from(values));
+
+  const std::string data = qi::py::encode(py::cast(values), "[i]");
+  EXPECT_EQ(std::string(static_cast<const char*>(expected.data()), expected.size()), data);
+  EXPECT_TRUE(qi::py::decode(py::bytes(data), "[i]").equal(py::cast(values)));
+}
+
+TEST_F(BinaryCodecTest, RawDataIsInlined)
+{
+  const auto value = py::make_tuple(py::bytes("cookie"), 42);
+  const auto data = qi::py::encode(value, "(ri)");
+
+  const auto decoded = qi::py::decode(data, "(ri)");
+  ASSERT_EQ(2u, py::len(decoded));
+  EXPECT_EQ("cookie", decoded[py::int_(0)].attr("tobytes")().cast<std::string>());
+  EXPECT_EQ(42, decoded[py::int_(1)].cast<int>());
+}
+
+TEST_F(BinaryCodecTest, ThrowsOnInvalidData)
+{
+  EXPECT_THROW(qi::py::encode(py::int_(42), "[i"), std::invalid_argument);
+  const auto data = qi::py::encode(py::int_(42), "i");
+  EXPECT_THROW(qi::py::decode(py::bytes(std::string(data) + '\0'), "i"), std::runtime_error);
+}
+
 struct TypePassing : qi::py::test::Execute,
                      testing::Test
 {